@@ -0,0 +1,132 @@
+#include "binarylogsink.h"
+#include "logringbuffer.h"
+
+#include <cstring>
+
+using namespace yasem;
+
+static const quint32 LOG_BINARY_MIN_CAPACITY = 16;
+
+BinaryLogSink::BinaryLogSink():
+    m_header(NULL),
+    m_records(NULL)
+{
+
+}
+
+BinaryLogSink::~BinaryLogSink()
+{
+    close();
+}
+
+/**
+ * @brief BinaryLogSink::open
+ *
+ * Opens the ring file. Existing file with the same layout is continued,
+ * otherwise it's recreated with the given size in bytes.
+ */
+bool BinaryLogSink::open(const QString &file_name, qint64 size)
+{
+    QMutexLocker locker(&m_mutex);
+    if(m_header != NULL) return false;
+
+    const quint32 capacity = qMax<quint32>(LOG_BINARY_MIN_CAPACITY, (size - sizeof(LogBinaryHeader)) / sizeof(LogBinaryRecord));
+    const qint64 file_size = sizeof(LogBinaryHeader) + (qint64)capacity * sizeof(LogBinaryRecord);
+
+    m_file.setFileName(file_name);
+    if(!m_file.open(QFile::ReadWrite))
+        return false;
+
+    LogBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    bool valid = m_file.size() == file_size
+            && m_file.read((char*)&header, sizeof(header)) == sizeof(header)
+            && header.magic == LOG_BINARY_MAGIC
+            && header.version == LOG_BINARY_VERSION
+            && header.record_size == sizeof(LogBinaryRecord)
+            && header.capacity == capacity;
+
+    if(!valid)
+    {
+        // Old content is dropped: zero sequence marks slots as empty
+        if(!m_file.resize(0) || !m_file.resize(file_size))
+        {
+            m_file.close();
+            return false;
+        }
+    }
+
+    uchar* data = m_file.map(0, file_size);
+    if(data == NULL)
+    {
+        m_file.close();
+        return false;
+    }
+
+    m_header = (LogBinaryHeader*) data;
+    m_records = (LogBinaryRecord*) (data + sizeof(LogBinaryHeader));
+
+    if(!valid)
+    {
+        m_header->version = LOG_BINARY_VERSION;
+        m_header->record_size = sizeof(LogBinaryRecord);
+        m_header->capacity = capacity;
+        m_header->next_sequence = 1;
+        m_header->magic = LOG_BINARY_MAGIC;
+    }
+
+    return true;
+}
+
+void BinaryLogSink::close()
+{
+    QMutexLocker locker(&m_mutex);
+    if(m_header == NULL) return;
+
+    m_file.unmap((uchar*) m_header);
+    m_file.close();
+    m_header = NULL;
+    m_records = NULL;
+}
+
+bool BinaryLogSink::isOpen() const
+{
+    return m_header != NULL;
+}
+
+void BinaryLogSink::write(const LogRecord &record)
+{
+    QMutexLocker locker(&m_mutex);
+    if(m_header == NULL) return;
+
+    const quint64 sequence = m_header->next_sequence++;
+    LogBinaryRecord* slot = &m_records[(sequence - 1) % m_header->capacity];
+
+    slot->sequence = 0;
+    slot->timestamp = record.timestamp;
+    slot->thread_id = record.thread_id;
+    slot->type = record.type;
+    slot->reserved = 0;
+
+    memset(slot->category, 0, LOG_BINARY_CATEGORY_SIZE);
+    qstrncpy(slot->category, record.category, LOG_BINARY_CATEGORY_SIZE);
+
+    // Function is the only context that is printed for these types
+    int length = 0;
+    if(!record.function.isEmpty())
+    {
+        length = qMin(record.function.size(), LOG_BINARY_MESSAGE_SIZE);
+        memcpy(slot->message, record.function.constData(), length);
+        if(!record.message.isEmpty() && length + 2 <= LOG_BINARY_MESSAGE_SIZE)
+        {
+            memcpy(slot->message + length, ": ", 2);
+            length += 2;
+        }
+    }
+
+    const int message_length = qMin(record.message.size(), LOG_BINARY_MESSAGE_SIZE - length);
+    memcpy(slot->message + length, record.message.constData(), message_length);
+    slot->length = length + message_length;
+
+    slot->sequence = sequence;
+}
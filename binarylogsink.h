@@ -0,0 +1,42 @@
+#ifndef BINARYLOGSINK_H
+#define BINARYLOGSINK_H
+
+#include "logformat.h"
+
+#include <QFile>
+#include <QMutex>
+
+namespace yasem {
+
+struct LogRecord;
+
+/**
+ * @brief Writes log records into a memory-mapped ring file of fixed size.
+ *
+ * Records are copied into the mapping without any text formatting. The file never
+ * grows past its size: the oldest records are overwritten. Mapped pages are written
+ * back by the kernel, so records survive a crash of the process.
+ * Use tools/logdecoder to convert the file into text log.
+ */
+class BinaryLogSink
+{
+public:
+    BinaryLogSink();
+    ~BinaryLogSink();
+
+    bool open(const QString &file_name, qint64 size);
+    void close();
+    bool isOpen() const;
+
+    void write(const LogRecord &record);
+
+protected:
+    QFile m_file;
+    LogBinaryHeader* m_header;
+    LogBinaryRecord* m_records;
+    QMutex m_mutex;
+};
+
+}
+
+#endif // BINARYLOGSINK_H
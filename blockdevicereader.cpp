@@ -0,0 +1,174 @@
+#include "blockdevicereader.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+using namespace yasem;
+
+static const quint64 SECTOR_SIZE = 512;
+static const int CDROM_MAJOR = 11;
+
+BlockDeviceReader::BlockDeviceReader(const QString &root):
+    m_root(QDir(root).absolutePath())
+{
+    if(!m_root.endsWith('/'))
+        m_root.append('/');
+}
+
+/**
+ * @brief BlockDeviceReader::readDisks
+ *
+ * Returns disks from /sys/block with their partitions and mount points.
+ * Virtual devices without backing hardware (loop, ram, dm, etc.) are skipped.
+ */
+QList<BlockDevice> BlockDeviceReader::readDisks() const
+{
+    QList<BlockDevice> result;
+
+    QHash<QString, MountInfo> mounts;
+    for(const MountInfo& mount: readMounts())
+    {
+        // The first mount of a device is the one we're interested in
+        if(!mounts.contains(mount.device))
+            mounts.insert(mount.device, mount);
+    }
+
+    auto applyMount = [&mounts](BlockDevice& device) {
+        auto iterator = mounts.constFind(device.device);
+        if(iterator != mounts.constEnd())
+        {
+            device.mount_point = iterator.value().mount_point;
+            device.fs_type = iterator.value().fs_type;
+        }
+    };
+
+    QDir block_dir(m_root + "sys/block");
+    for(const QString& name: block_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::System))
+    {
+        const QString sys_path = block_dir.absoluteFilePath(name);
+        if(!QFileInfo(sys_path + "/device").exists())
+            continue;
+
+        BlockDevice disk;
+        if(!readDevice(sys_path, name, disk))
+            continue;
+
+        QString model_dir = sys_path + "/device/";
+        disk.model = readAttribute(model_dir + "model");
+        if(disk.model.isEmpty())
+            disk.model = readAttribute(model_dir + "name"); // MMC/SD cards
+        disk.vendor = readAttribute(model_dir + "vendor");
+        disk.revision = readAttribute(model_dir + "rev");
+        disk.removable = readAttribute(sys_path + "/removable") == "1";
+        disk.cdrom = disk.device.section(':', 0, 0).toInt() == CDROM_MAJOR;
+        applyMount(disk);
+
+        // Partitions are subdirectories that have "partition" attribute
+        QDir disk_dir(sys_path);
+        for(const QString& part_name: disk_dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::System))
+        {
+            const QString part_path = disk_dir.absoluteFilePath(part_name);
+            if(!QFileInfo(part_path + "/partition").exists())
+                continue;
+
+            BlockDevice partition;
+            if(!readDevice(part_path, part_name, partition))
+                continue;
+
+            partition.removable = disk.removable;
+            partition.model = disk.model;
+            partition.vendor = disk.vendor;
+            applyMount(partition);
+            disk.partitions.append(partition);
+        }
+
+        result.append(disk);
+    }
+
+    return result;
+}
+
+/**
+ * @brief BlockDeviceReader::readMounts
+ *
+ * Parses /proc/self/mountinfo. Line format:
+ * 36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+ */
+QList<MountInfo> BlockDeviceReader::readMounts() const
+{
+    QList<MountInfo> result;
+
+    QFile file(m_root + "proc/self/mountinfo");
+    if(!file.open(QFile::ReadOnly))
+        return result;
+
+    // procfs files report zero size, so they must be read line by line
+    QByteArray line;
+    while(!(line = file.readLine()).isEmpty())
+    {
+        const QList<QByteArray> fields = line.trimmed().split(' ');
+        const int separator = fields.indexOf("-");
+        if(fields.size() < 5 || separator < 0 || separator + 2 >= fields.size())
+            continue;
+
+        MountInfo mount;
+        mount.device = QString::fromLatin1(fields.at(2));
+        mount.mount_point = unescapeMountPath(QString::fromLocal8Bit(fields.at(4)));
+        mount.fs_type = QString::fromLatin1(fields.at(separator + 1));
+        mount.source = unescapeMountPath(QString::fromLocal8Bit(fields.at(separator + 2)));
+        result.append(mount);
+    }
+
+    return result;
+}
+
+/**
+ * @brief BlockDeviceReader::unescapeMountPath
+ *
+ * Kernel escapes space, tab, newline and backslash in mount paths as octal (\040).
+ */
+QString BlockDeviceReader::unescapeMountPath(const QString &path)
+{
+    if(!path.contains('\\'))
+        return path;
+
+    QString result;
+    result.reserve(path.length());
+    for(int index = 0; index < path.length(); index++)
+    {
+        if(path.at(index) == '\\' && index + 3 < path.length())
+        {
+            bool ok = false;
+            int code = path.mid(index + 1, 3).toInt(&ok, 8);
+            if(ok)
+            {
+                result.append(QChar(code));
+                index += 3;
+                continue;
+            }
+        }
+        result.append(path.at(index));
+    }
+    return result;
+}
+
+bool BlockDeviceReader::readDevice(const QString &sys_path, const QString &name, BlockDevice &device) const
+{
+    device.name = name;
+    device.sys_path = m_root + "sys/class/block/" + name;
+    device.device_file = QString("/dev/%1").arg(name);
+    device.device = readAttribute(sys_path + "/dev");
+    device.size = readAttribute(sys_path + "/size").toULongLong() * SECTOR_SIZE;
+
+    // Empty card readers and CD drives without a disk have zero size
+    return !device.device.isEmpty() && device.size > 0;
+}
+
+QString BlockDeviceReader::readAttribute(const QString &path) const
+{
+    QFile file(path);
+    if(!file.open(QFile::ReadOnly))
+        return QString();
+    return QString::fromLocal8Bit(file.readAll()).trimmed();
+}
@@ -0,0 +1,67 @@
+#ifndef BLOCKDEVICEREADER_H
+#define BLOCKDEVICEREADER_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+
+namespace yasem {
+
+struct MountInfo
+{
+    QString device;         // major:minor
+    QString mount_point;
+    QString fs_type;
+    QString source;
+};
+
+struct BlockDevice
+{
+    BlockDevice():
+        size(0),
+        removable(false),
+        cdrom(false)
+    {}
+
+    QString name;           // sda, sda1, mmcblk0p1
+    QString device_file;    // /dev/sda1
+    QString sys_path;       // /sys/class/block/sda1
+    QString device;         // major:minor
+    quint64 size;           // bytes
+    bool removable;
+    bool cdrom;
+    QString model;
+    QString vendor;
+    QString revision;
+    QString mount_point;
+    QString fs_type;
+    QList<BlockDevice> partitions;
+};
+
+/**
+ * @brief Reads block devices from sysfs and mounts from /proc/self/mountinfo.
+ *
+ * Builds disk -> partition tree without running any external tools.
+ * All paths are resolved relative to the root directory, so the reader
+ * can be pointed to a fake sysfs tree.
+ */
+class BlockDeviceReader
+{
+public:
+    explicit BlockDeviceReader(const QString &root = "/");
+
+    QList<BlockDevice> readDisks() const;
+    QList<MountInfo> readMounts() const;
+
+    static QString unescapeMountPath(const QString &path);
+
+protected:
+    bool readDevice(const QString &sys_path, const QString &name, BlockDevice &device) const;
+    QString readAttribute(const QString &path) const;
+
+    QString m_root;
+};
+
+}
+
+#endif // BLOCKDEVICEREADER_H
@@ -1,31 +1,129 @@
 #include "configimpl.h"
 #include "macros.h"
+#include "logcategories.h"
+#include "settingsregistry.h"
+#include "configwritebehind.h"
+#include "inifile.h"
+#include "configsnapshot.h"
+#include "core.h"
+
+#include <QSet>
+#include <QJsonArray>
+#include <QThread>
 
 using namespace yasem;
 
+static const char* const CONFIG_SNAPSHOT_NAME = "config.cache";
+static const int CONFIG_SNAPSHOT_SAVE_DELAY = 1000; // ms
+
+ConfigPath::ConfigPath(const QString &path) :
+    m_path(path.startsWith('/') ? path.mid(1) : path),
+    m_item(NULL),
+    m_generation(0)
+{
+
+}
+
+const QString& ConfigPath::path() const
+{
+    return m_path;
+}
+
 ConfigImpl::ConfigImpl(QObject *parent) :
-    SDK::Config(parent)
+    SDK::Config(parent),
+    m_save_depth(0),
+    m_index_generation(1),
+    m_snapshot(NULL),
+    m_revision(0),
+    m_change_notification_pending(false)
 {
+    m_snapshot_timer.setSingleShot(true);
+    m_snapshot_timer.setInterval(CONFIG_SNAPSHOT_SAVE_DELAY);
+    connect(&m_snapshot_timer, &QTimer::timeout, this, &ConfigImpl::saveSnapshot);
+}
 
+ConfigImpl::~ConfigImpl()
+{
+    saveSnapshot();
+    delete m_snapshot;
+    qDeleteAll(m_slots);
+    qDeleteAll(m_ini_files);
 }
 
 bool ConfigImpl::addConfigGroup(SDK::ConfigTreeGroup *group)
 {
     if(!m_config_groups.contains(group->m_key))
+    {
         m_config_groups.insert(group->m_key, group);
+        indexContainer(group->getKey(), group);
+
+        // Plugins keep pointers to their items and read them directly
+        if(!group->m_is_built_in)
+        {
+            m_shared_groups.insert(group);
+            ensureLoadedRecursive(group);
+        }
+    }
     return true;
 }
 
 QHash<const QString&, SDK::ConfigTreeGroup *> ConfigImpl::getConfigGroups()
 {
+    // Groups are going to be shown or iterated, so all of them should be loaded
+    for(SDK::ConfigTreeGroup* group: m_config_groups)
+        ensureLoadedRecursive(group);
     return m_config_groups;
 }
 
+/**
+ * @brief ConfigImpl::setItemDirty
+ *
+ * Marks the item and its parents. Dirty leaf items are remembered,
+ * so saving the whole config doesn't have to look for them in the tree.
+ */
 void ConfigImpl::setItemDirty(SDK::ConfigItem* item, bool value)
+{
+    if(item == NULL) return;
+
+    if(value)
+    {
+        addDirtyItem(item);
+        if(!item->isContainer())
+        {
+            updateSlot(item);
+            recordChange(ensureIndexed(item));
+        }
+    }
+    else if(!item->isContainer())
+        m_dirty_items.remove(item);
+
+    markDirty(item, value);
+}
+
+void ConfigImpl::markDirty(SDK::ConfigItem *item, bool value)
 {
     if(item == NULL) return;
     item->m_is_dirty = value;
-    setItemDirty(item->getParentItem(), value);
+    markDirty(item->getParentItem(), value);
+}
+
+void ConfigImpl::addDirtyItem(SDK::ConfigItem *item)
+{
+    if(item->isContainer())
+    {
+        for(SDK::ConfigItem* child: static_cast<SDK::ConfigContainer*>(item)->getItems())
+        {
+            child->m_is_dirty = true;
+            addDirtyItem(child);
+        }
+        return;
+    }
+
+    SDK::ConfigContainer* container = dynamic_cast<SDK::ConfigContainer*>(item->getParentItem());
+    if(container == NULL) return;
+
+    m_dirty_items.insert(item, container);
+    connect(item, &QObject::destroyed, this, &ConfigImpl::onItemDestroyed, Qt::UniqueConnection);
 }
 
 bool ConfigImpl::addBuiltInConfigGroup(SDK::ConfigTreeGroup *group)
@@ -38,7 +136,13 @@ bool ConfigImpl::addBuiltInConfigGroup(SDK::ConfigTreeGroup *group)
 SDK::ConfigTreeGroup *ConfigImpl::getDefaultGroup(const QString &id)
 {
     if(m_config_groups.contains(id))
-        return m_config_groups.value(id);
+    {
+        // The group may be read or extended by the caller without lookups
+        SDK::ConfigTreeGroup* group = m_config_groups.value(id);
+        m_shared_groups.insert(group);
+        ensureLoadedRecursive(group);
+        return group;
+    }
 
     WARN() << "Default group" << id << "not found!";
     return NULL;
@@ -46,16 +150,59 @@ SDK::ConfigTreeGroup *ConfigImpl::getDefaultGroup(const QString &id)
 }
 
 void ConfigImpl::save(SDK::ConfigContainer *container)
-{    
+{
+    // Files are written in background once the whole subtree has been saved
+    m_save_depth++;
     if(container == NULL)
+        saveDirtyItems();
+    else
+        saveContainer(container);
+    if(--m_save_depth == 0)
+        ConfigWriteBehind::instance()->commit();
+}
+
+/**
+ * @brief ConfigImpl::saveDirtyItems
+ *
+ * Saves items that have been modified since the last save.
+ */
+void ConfigImpl::saveDirtyItems()
+{
+    CONFIG_DEBUG() << "Saving" << m_dirty_items.size() << "modified items...";
+
+    QHash<SDK::ConfigItem*, SDK::ConfigContainer*> items;
+    items.swap(m_dirty_items);
+
+    QSet<SDK::ConfigContainer*> containers;
+    for(auto iterator = items.constBegin(); iterator != items.constEnd(); ++iterator)
     {
-        DEBUG() << "Saving entire config tree...";
-        for(SDK::ConfigTreeGroup* gr: m_config_groups)
-            save(gr);
-        return;
+        SDK::ConfigContainer* container = iterator.value();
+        if(container->getConfigFile().isEmpty())
+            continue;
+
+        saveItem(container, iterator.key());
+        containers.insert(container);
     }
 
-    DEBUG() << "Saving item" << container->getTitle();
+    for(SDK::ConfigContainer* container: containers)
+        markDirty(container, false);
+}
+
+void ConfigImpl::saveItem(SDK::ConfigContainer *container, SDK::ConfigItem *item)
+{
+    QVariant value = item->getValue();
+    if(value.isNull())
+        value = item->getDefaultValue();
+
+    ConfigWriteBehind::instance()->setValue(container->getConfigFile(), container->getKey() + "/" + item->getKey(), value);
+    m_dirty_items.remove(item);
+    item->setDirty(false);
+    emit item->saved();
+}
+
+void ConfigImpl::saveContainer(SDK::ConfigContainer *container)
+{
+    CONFIG_DEBUG() << "Saving item" << container->getTitle();
 
     container->setDirty(false);
 
@@ -64,27 +211,15 @@ void ConfigImpl::save(SDK::ConfigContainer *container)
     //First saving the items we can save (leaves)...
     if(!config_file.isEmpty())
     {
-        DEBUG() << "Saving container" << container->getKey() << "to" << config_file << "...";
-        QSettings* settings = SDK::Core::instance()->settings(config_file);
-        settings->beginGroup(container->getKey());
-
+        CONFIG_DEBUG() << "Saving container" << container->getKey() << "to" << config_file << "...";
         for(SDK::ConfigItem* item: container->getItems())
         {
             if(!item->isContainer() && item->isDirty())
-            {
-                QVariant value = item->getValue();
-                if(value.isNull())
-                    value = item->getDefaultValue();
-
-                settings->setValue(item->getKey(), value);
-                item->setDirty(false);
-                emit item->saved();
-            }
+                saveItem(container, item);
         }
-        settings->endGroup();
     }
     //else
-    //    DEBUG() << "Config tree item" << container->getTitle() << "doesn't have config file";
+    //    CONFIG_DEBUG() << "Config tree item" << container->getTitle() << "doesn't have config file";
 
     //... then tree groups, pages, etc.
     for(SDK::ConfigItem* item: container->getItems())
@@ -93,7 +228,7 @@ void ConfigImpl::save(SDK::ConfigContainer *container)
         {
             SDK::ConfigContainer* subcontainer = static_cast<SDK::ConfigContainer*>(item);
             Q_ASSERT(subcontainer != NULL);
-            save(subcontainer);
+            saveContainer(subcontainer);
         }
     }
 }
@@ -102,7 +237,7 @@ void ConfigImpl::reset(SDK::ConfigContainer *container)
 {
     if(container == NULL)
     {
-        DEBUG() << "Reseting entire config tree...";
+        CONFIG_DEBUG() << "Reseting entire config tree...";
         for(SDK::ConfigTreeGroup* gr: m_config_groups)
             reset(gr);
         return;
@@ -116,57 +251,469 @@ void ConfigImpl::load(SDK::ConfigContainer *container)
 {
     if(container == NULL)
     {
-        DEBUG() << "Loading entire config tree...";
+        CONFIG_DEBUG() << "Loading entire config tree...";
         for(SDK::ConfigTreeGroup* gr: m_config_groups)
             load(gr);
         return;
     }
 
-    DEBUG() << "Loading config tree item" << container->getTitle();
+    loadItems(container);
+
+    for(SDK::ConfigItem* item: container->getItems())
+    {
+        if(item->isContainer())
+        {
+            CONFIG_DEBUG() << ".... Loading settings container " << item->getKey();
+            load(static_cast<SDK::ConfigContainer*>(item));
+        }
+    }
+}
+
+/**
+ * @brief ConfigImpl::loadItems
+ *
+ * Loads values of the container's own items. Subcontainers are not loaded.
+ */
+void ConfigImpl::loadItems(SDK::ConfigContainer *container)
+{
+    CONFIG_DEBUG() << "Loading config tree item" << container->getTitle();
+
+    if(!m_loaded_containers.contains(container))
+        connect(container, &QObject::destroyed, this, &ConfigImpl::onItemDestroyed, Qt::UniqueConnection);
+    m_loaded_containers.insert(container, container->getItems().size());
+
+    // Items may have been added after the group was registered
+    for(SDK::ConfigItem* item: container->getItems())
+        ensureIndexed(item);
 
     QString config_file = container->getConfigFile();
     if(config_file.isEmpty())
     {
-        DEBUG() << "Config tree item" << container->getTitle() << "doesn't have config file";
+        CONFIG_DEBUG() << "Config tree item" << container->getTitle() << "doesn't have config file";
         return;
     }
 
-    QSettings* settings = SDK::Core::instance()->settings(config_file);
-    settings->beginGroup(container->getKey());
+    // Changes made through QSettings must reach the file before it's compared or parsed
+    SettingsRegistry::instance()->sync(config_file);
+
+    // Snapshot is used while the file is unchanged, otherwise the file is parsed
+    const QHash<QString, QVariant>* cached = snapshot()->values(config_file, SettingsRegistry::instance()->filePath(config_file));
+    IniFile* ini = cached == NULL ? iniFile(config_file) : NULL;
+    const QString group = container->getKey() + "/";
 
+    QList<SDK::ConfigItem*> loaded_items;
+    QList<SDK::ConfigItem*> changed_items;
     for(SDK::ConfigItem* item: container->getItems())
     {
+        // Modified items keep their values until they are saved
+        if(m_dirty_items.contains(item))
+            continue;
+
         item->setDirty(false);
         if(!item->isContainer())
         {
-            QVariant val = settings->value(item->getKey());
-            DEBUG() << "....loading item " << item->getKey() << ", value " << val;
+            // Values that haven't been written yet are newer than the file
+            QVariant val;
+            if(!ConfigWriteBehind::instance()->pendingValue(config_file, group + item->getKey(), val))
+                val = cached != NULL ? cached->value(group + item->getKey()) : ini->value(group + item->getKey());
+            CONFIG_DEBUG() << "....loading item " << item->getKey() << ", value " << val;
+            const QVariant previous = item->getValue();
             if(val.isNull())
                 item->setValue(item->getDefaultValue());
             else
                 item->setValue(val);
+            loaded_items.append(item);
+            if(item->getValue() != previous)
+                changed_items.append(item);
         }
-        else
+    }
+
+    // Binding a slot may look up and load other containers
+    for(SDK::ConfigItem* item: loaded_items)
+        updateSlot(item);
+
+    for(SDK::ConfigItem* item: changed_items)
+        recordChange(ensureIndexed(item));
+}
+
+/**
+ * @brief ConfigImpl::iniFile
+ *
+ * Returns the parsed config file. The file is parsed again if it has been changed
+ * since, e.g. by ConfigWriteBehind. QSettings objects of the file should be synced before.
+ */
+IniFile* ConfigImpl::iniFile(const QString &config_file)
+{
+    IniFile* ini = m_ini_files.value(config_file, NULL);
+    if(ini == NULL)
+    {
+        ini = new IniFile(SettingsRegistry::instance()->filePath(config_file));
+        m_ini_files.insert(config_file, ini);
+    }
+
+    if(!ini->isOpen() || ini->isStale())
+    {
+        CONFIG_DEBUG() << "Reading config file" << ini->fileName();
+        if(ini->open())
         {
-            DEBUG() << ".... Loading settings container " << item->getKey();
-            load(dynamic_cast<SDK::ConfigContainer*>(item));
+            snapshot()->update(config_file, *ini);
+            m_snapshot_timer.start();
         }
+        else
+            WARN() << "Cannot read config file" << ini->fileName();
+    }
+    return ini;
+}
+
+ConfigSnapshot* ConfigImpl::snapshot()
+{
+    // Config directory is known only after the core has been initialized
+    if(m_snapshot == NULL)
+    {
+        m_snapshot = new ConfigSnapshot(SDK::Core::instance()->getConfigDir().append(CONFIG_SNAPSHOT_NAME));
+        m_snapshot->open();
+    }
+    return m_snapshot;
+}
+
+void ConfigImpl::saveSnapshot()
+{
+    m_snapshot_timer.stop();
+    if(m_snapshot != NULL)
+        m_snapshot->save();
+}
+
+/**
+ * @brief ConfigImpl::ensureLoaded
+ *
+ * Loads the container if its values haven't been loaded yet or items have been added to it since.
+ * Containers are loaded on first access instead of loading the whole tree at startup.
+ */
+void ConfigImpl::ensureLoaded(SDK::ConfigContainer *container)
+{
+    if(container != NULL && m_loaded_containers.value(container, -1) != container->getItems().size())
+        loadItems(container);
+}
+
+void ConfigImpl::ensureLoadedRecursive(SDK::ConfigContainer *container)
+{
+    ensureLoaded(container);
+    for(SDK::ConfigItem* item: container->getItems())
+    {
+        if(item->isContainer())
+            ensureLoadedRecursive(static_cast<SDK::ConfigContainer*>(item));
     }
+}
 
-    settings->endGroup();
+/**
+ * @brief ConfigImpl::addPreloadHint
+ *
+ * Marks a config subtree that is needed at startup, so it's loaded by preload().
+ */
+void ConfigImpl::addPreloadHint(const QString &path)
+{
+    if(!m_preload_hints.contains(path))
+        m_preload_hints.append(path);
+}
+
+void ConfigImpl::preload()
+{
+    CONFIG_DEBUG() << "Preloading config" << m_preload_hints;
+    for(const QString& path: m_preload_hints)
+    {
+        SDK::ConfigItem* item = lookup(path);
+        if(item != NULL && item->isContainer())
+            ensureLoadedRecursive(static_cast<SDK::ConfigContainer*>(item));
+        else
+            WARN() << "Config container" << path << "not found!";
+    }
+}
+
+/**
+ * @brief ConfigImpl::loadAddedItems
+ *
+ * Loads items that plugins have added to their own groups and to the groups returned
+ * by getDefaultGroup(). Called when plugins have been initialized.
+ */
+void ConfigImpl::loadAddedItems()
+{
+    for(SDK::ConfigTreeGroup* group: m_shared_groups)
+        ensureLoadedRecursive(group);
 }
 
 SDK::ConfigItem *ConfigImpl::findItem(const QString &path)
 {
-    return findItem(path.split("/"));
+    SDK::ConfigItem* result = lookup(path);
+    Q_ASSERT(result != NULL);
+    return result;
 }
 
 SDK::ConfigItem *ConfigImpl::findItem(const QStringList &path)
+{
+    SDK::ConfigItem* result = lookup(path.join('/'));
+    Q_ASSERT(result != NULL);
+    return result;
+}
+
+/**
+ * @brief ConfigImpl::lookup
+ *
+ * Returns an item by its full path or NULL if there is no such item.
+ * Items that have been added to containers after their group is registered
+ * are found in the tree and indexed on the first lookup.
+ * Lookups may load and index items, so they're done in the main thread only.
+ * Other threads read values through slots (@see slot()).
+ */
+SDK::ConfigItem *ConfigImpl::lookup(const QString &path)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+    if(path.startsWith('/'))
+        return lookup(path.mid(1));
+
+    SDK::ConfigItem* result = m_path_index.value(path, NULL);
+    if(result == NULL)
+    {
+        result = findItemInTree(path.split('/'));
+        if(result != NULL)
+            indexItem(path, result);
+    }
+
+    ensureItemLoaded(result);
+    return result;
+}
+
+/**
+ * @brief ConfigImpl::lookup
+ *
+ * Same as lookup() by string, but the item cached in the path is returned
+ * without hashing or splitting the path while no item has been removed.
+ */
+SDK::ConfigItem *ConfigImpl::lookup(ConfigPath &path)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+    SDK::ConfigItem* result = resolve(path);
+    ensureItemLoaded(result);
+    return result;
+}
+
+/**
+ * @brief ConfigImpl::resolve
+ *
+ * Finds the item of the path without loading it.
+ */
+SDK::ConfigItem *ConfigImpl::resolve(ConfigPath &path)
+{
+    if(path.m_item != NULL && path.m_generation == m_index_generation)
+        return path.m_item;
+
+    SDK::ConfigItem* result = m_path_index.value(path.m_path, NULL);
+    if(result == NULL)
+    {
+        // Split once, items that don't exist yet are searched on every lookup
+        if(path.m_keys.isEmpty())
+            path.m_keys = path.m_path.split('/');
+        result = findItemInTree(path.m_keys);
+        if(result != NULL)
+            indexItem(path.m_path, result);
+    }
+
+    path.m_item = result;
+    path.m_generation = m_index_generation;
+    return result;
+}
+
+void ConfigImpl::ensureItemLoaded(SDK::ConfigItem *item)
+{
+    if(item == NULL) return;
+
+    if(item->isContainer())
+        ensureLoaded(static_cast<SDK::ConfigContainer*>(item));
+    else
+        ensureLoaded(dynamic_cast<SDK::ConfigContainer*>(item->getParentItem()));
+}
+
+void ConfigImpl::onItemDestroyed(QObject *item)
+{
+    m_dirty_items.remove(static_cast<SDK::ConfigItem*>(item));
+    m_slot_items.remove(static_cast<SDK::ConfigItem*>(item));
+    m_loaded_containers.remove(item);
+    m_shared_groups.remove(static_cast<SDK::ConfigTreeGroup*>(item));
+
+    auto iterator = m_indexed_paths.find(item);
+    if(iterator == m_indexed_paths.end()) return;
+
+    recordChange(iterator.value(), true);
+    m_path_index.remove(iterator.value());
+    m_indexed_paths.erase(iterator);
+
+    // Invalidates pointers cached in ConfigPath
+    m_index_generation++;
+}
+
+void ConfigImpl::indexItem(const QString &path, SDK::ConfigItem *item)
+{
+    m_path_index.insert(path, item);
+    m_indexed_paths.insert(item, path);
+    connect(item, &QObject::destroyed, this, &ConfigImpl::onItemDestroyed, Qt::UniqueConnection);
+}
+
+void ConfigImpl::indexContainer(const QString &path, SDK::ConfigContainer *container)
+{
+    indexItem(path, container);
+    for(SDK::ConfigItem* item: container->getItems())
+    {
+        const QString item_path = QString(path).append('/').append(item->getKey());
+        if(item->isContainer())
+            indexContainer(item_path, static_cast<SDK::ConfigContainer*>(item));
+        else
+            indexItem(item_path, item);
+    }
+}
+
+/**
+ * @brief ConfigImpl::ensureIndexed
+ *
+ * Indexes the item if it has been added to the tree after its group was registered.
+ * Returns the item's path. Only indexed items are reported as removed when destroyed.
+ */
+QString ConfigImpl::ensureIndexed(SDK::ConfigItem *item)
+{
+    QString path = m_indexed_paths.value(item);
+    if(!path.isEmpty())
+        return path;
+
+    path = itemPath(item);
+    indexItem(path, item);
+    return path;
+}
+
+void ConfigImpl::bindSlot(const QString &path, ConfigSlotBase *slot)
+{
+    SDK::ConfigItem* item = lookup(path);
+    if(item == NULL) return;
+
+    m_slot_items.insert(item, slot);
+    connect(item, &QObject::destroyed, this, &ConfigImpl::onItemDestroyed, Qt::UniqueConnection);
+    slot->update(item->getValue());
+}
+
+/**
+ * @brief ConfigImpl::updateSlot
+ *
+ * Copies the value of the item to its slot.
+ * Slots requested before their items were created are bound here.
+ */
+void ConfigImpl::updateSlot(SDK::ConfigItem *item)
+{
+    ConfigSlotBase* slot = m_slot_items.value(item, NULL);
+    if(slot == NULL)
+    {
+        if(m_slot_items.size() == m_slots.size()) return;
+
+        const QString path = itemPath(item);
+        slot = m_slots.value(path, NULL);
+        if(slot == NULL) return;
+
+        bindSlot(path, slot);
+        return;
+    }
+    slot->update(item->getValue());
+}
+
+QString ConfigImpl::itemPath(SDK::ConfigItem *item) const
+{
+    QString path = item->getKey();
+    for(SDK::ConfigItem* parent = item->getParentItem(); parent != NULL; parent = parent->getParentItem())
+        path.prepend('/').prepend(parent->getKey());
+    return path;
+}
+
+quint64 ConfigImpl::revision() const
+{
+    return m_revision;
+}
+
+/**
+ * @brief ConfigImpl::changesSince
+ *
+ * Returns items that have been changed or removed after the revision as JSON patch operations:
+ * {"revision": 12, "patches": [{"op": "replace", "path": "/other/network_statistics/enabled", "value": true}]}
+ * Clients read the whole tree once after taking revision(), then keep the returned revision
+ * and ask for changes since it. Serialize with QJsonDocument::Compact for transfer.
+ */
+QJsonObject ConfigImpl::changesSince(quint64 revision)
+{
+    // Items are resolved without loading, so reading values doesn't change the log.
+    // Paths keep their items between calls, so polling clients don't search the tree.
+    QJsonArray patches;
+    for(auto iterator = m_change_log.upperBound(revision); iterator != m_change_log.end(); ++iterator)
+    {
+        ConfigPath& path = iterator.value();
+        QJsonObject patch;
+        SDK::ConfigItem* item = m_removed_paths.contains(path.path()) ? NULL : resolve(path);
+        if(item != NULL)
+        {
+            patch.insert("op", QStringLiteral("replace"));
+            patch.insert("path", QString(path.path()).prepend('/'));
+            patch.insert("value", QJsonValue::fromVariant(item->getValue()));
+        }
+        else
+        {
+            patch.insert("op", QStringLiteral("remove"));
+            patch.insert("path", QString(path.path()).prepend('/'));
+        }
+        patches.append(patch);
+    }
+
+    QJsonObject result;
+    result.insert("revision", double(m_revision));
+    result.insert("patches", patches);
+    return result;
+}
+
+/**
+ * @brief ConfigImpl::recordChange
+ *
+ * Moves the path to the end of the change log with a new revision.
+ * The log keeps one record per path, so its size is limited by the number of items.
+ */
+void ConfigImpl::recordChange(const QString &path, bool removed)
+{
+    if(path.isEmpty()) return;
+
+    auto previous = m_change_revisions.find(path);
+    if(previous != m_change_revisions.end())
+        m_change_log.remove(previous.value());
+
+    m_revision++;
+    m_change_log.insert(m_revision, ConfigPath(path));
+    m_change_revisions.insert(path, m_revision);
+
+    if(removed)
+        m_removed_paths.insert(path);
+    else
+        m_removed_paths.remove(path);
+
+    // Changes made during one event loop iteration are reported once
+    if(!m_change_notification_pending)
+    {
+        m_change_notification_pending = true;
+        QMetaObject::invokeMethod(this, "notifyChanges", Qt::QueuedConnection);
+    }
+}
+
+void ConfigImpl::notifyChanges()
+{
+    m_change_notification_pending = false;
+    emit configChanged(m_revision);
+}
+
+SDK::ConfigItem *ConfigImpl::findItemInTree(const QStringList &path)
 {
     SDK::ConfigItem* result = NULL;
     if(!path.isEmpty())
     {
-        DEBUG() << "Looking in root";
+        CONFIG_DEBUG() << "Looking in root";
         if(path.length() >= 2)
         {
             int first_index = 0;
@@ -195,7 +742,5 @@ SDK::ConfigItem *ConfigImpl::findItem(const QStringList &path)
         }
     }
 
-    Q_ASSERT(result != NULL);
-
     return result;
 }
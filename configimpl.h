@@ -2,18 +2,52 @@
 #define YASEMSETTINGSIMPL_H
 
 #include "yasemsettings.h"
+#include "configkey.h"
 
 #include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QMap>
+#include <QJsonObject>
 
 namespace yasem {
 
+class IniFile;
+class ConfigSnapshot;
+
+/**
+ * @brief Precomputed config path for frequent lookups.
+ *
+ * Keeps the item found by the last lookup, so next lookups neither hash nor split
+ * the path until an item is removed from the tree (@see ConfigImpl::lookup()).
+ */
+class ConfigPath
+{
+public:
+    explicit ConfigPath(const QString &path = QString());
+
+    const QString& path() const;
+
+protected:
+    friend class ConfigImpl;
+
+    QString m_path;
+    QStringList m_keys;
+    SDK::ConfigItem* m_item;
+    quint32 m_generation;
+};
+
 class ConfigImpl : public SDK::Config
 {
     Q_OBJECT
 public:
     explicit ConfigImpl(QObject *parent = 0);
+    virtual ~ConfigImpl();
 
 signals:
+    void configChanged(quint64 revision);
 
 public slots:
 
@@ -23,8 +57,104 @@ public:
     QHash<const QString&, SDK::ConfigTreeGroup *> getConfigGroups();
     SDK::ConfigTreeGroup *getDefaultGroup(const QString &id);
 
+    SDK::ConfigItem* lookup(const QString& path);
+    SDK::ConfigItem* lookup(ConfigPath& path);
+
+    Q_INVOKABLE quint64 revision() const;
+    Q_INVOKABLE QJsonObject changesSince(quint64 revision);
+
+    void addPreloadHint(const QString& path);
+    void preload();
+    void loadAddedItems();
+    void ensureLoaded(SDK::ConfigContainer* container);
+
+    template<typename T>
+    const ConfigSlot<T>& slot(const ConfigKey<T>& key)
+    {
+        return slot<T>(key.path(), key.default_value);
+    }
+
+    /**
+     * @brief Returns a slot holding the native value of the item.
+     *
+     * Slots live until the config is destroyed, so callers may keep the reference.
+     * If the item doesn't exist yet, the slot holds the default value until it's loaded.
+     */
+    template<typename T>
+    const ConfigSlot<T>& slot(const QString& path, T default_value)
+    {
+        ConfigSlotBase* result = m_slots.value(path, NULL);
+        if(result == NULL)
+        {
+            result = new ConfigSlot<T>(default_value);
+            m_slots.insert(path, result);
+            bindSlot(path, result);
+        }
+        Q_ASSERT(dynamic_cast<ConfigSlot<T>*>(result) != NULL);
+        return *static_cast<ConfigSlot<T>*>(result);
+    }
+
+protected slots:
+    void onItemDestroyed(QObject* item);
+    void saveSnapshot();
+    void notifyChanges();
+
 protected:
     bool addBuiltInConfigGroup(SDK::ConfigTreeGroup *group);
+    void saveContainer(SDK::ConfigContainer *container);
+    void loadItems(SDK::ConfigContainer *container);
+    IniFile* iniFile(const QString &config_file);
+    ConfigSnapshot* snapshot();
+    void recordChange(const QString &path, bool removed = false);
+    void ensureLoadedRecursive(SDK::ConfigContainer *container);
+    void saveDirtyItems();
+    void saveItem(SDK::ConfigContainer *container, SDK::ConfigItem *item);
+    void markDirty(SDK::ConfigItem* item, bool value);
+    void addDirtyItem(SDK::ConfigItem* item);
+    void bindSlot(const QString& path, ConfigSlotBase* slot);
+    void updateSlot(SDK::ConfigItem* item);
+    QString itemPath(SDK::ConfigItem* item) const;
+    SDK::ConfigItem* findItemInTree(const QStringList& path);
+    void indexItem(const QString& path, SDK::ConfigItem* item);
+    void indexContainer(const QString& path, SDK::ConfigContainer* container);
+    QString ensureIndexed(SDK::ConfigItem* item);
+    SDK::ConfigItem* resolve(ConfigPath& path);
+    void ensureItemLoaded(SDK::ConfigItem* item);
+
+    int m_save_depth;
+
+    // Full path ("other/network_statistics/enabled") to item
+    QHash<QString, SDK::ConfigItem*> m_path_index;
+    QHash<QObject*, QString> m_indexed_paths;
+    // Incremented when an item is removed, invalidates items cached in ConfigPath
+    quint32 m_index_generation;
+
+    // Modified leaf items and their containers, saved by save() without a container
+    QHash<SDK::ConfigItem*, SDK::ConfigContainer*> m_dirty_items;
+
+    // Typed values by full path and by bound item
+    QHash<QString, ConfigSlotBase*> m_slots;
+    QHash<SDK::ConfigItem*, ConfigSlotBase*> m_slot_items;
+
+    // Containers whose values have been loaded and their item count at that time
+    QHash<QObject*, int> m_loaded_containers;
+    // Groups that plugins may hold and add items to
+    QSet<SDK::ConfigTreeGroup*> m_shared_groups;
+    QStringList m_preload_hints;
+
+    // Parsed config files by name
+    QHash<QString, IniFile*> m_ini_files;
+
+    // Values of config files from the previous run, saved after files are parsed
+    ConfigSnapshot* m_snapshot;
+    QTimer m_snapshot_timer;
+
+    // Last change of every changed path by revision, for changesSince()
+    quint64 m_revision;
+    QMap<quint64, ConfigPath> m_change_log;
+    QHash<QString, quint64> m_change_revisions;
+    QSet<QString> m_removed_paths;
+    bool m_change_notification_pending;
 
     // YasemSettings interface
 public slots:
@@ -0,0 +1,99 @@
+#ifndef CONFIGKEY_H
+#define CONFIGKEY_H
+
+#include <QString>
+#include <QVariant>
+
+#include <atomic>
+#include <type_traits>
+
+namespace yasem {
+
+/**
+ * @brief Compile-time path of a config container.
+ *
+ * Top level groups have no parent.
+ */
+class ConfigGroupKey
+{
+public:
+    constexpr explicit ConfigGroupKey(const char* key, const ConfigGroupKey* parent = nullptr):
+        key(key),
+        parent(parent)
+    {}
+
+    QString path() const
+    {
+        return parent != nullptr ? parent->path().append('/').append(key) : QString(key);
+    }
+
+    const char* const key;
+    const ConfigGroupKey* const parent;
+};
+
+/**
+ * @brief Compile-time config key with its type and default value.
+ *
+ * Resolved once to a ConfigSlot (@see ConfigImpl::slot()).
+ */
+template<typename T>
+class ConfigKey
+{
+public:
+    constexpr ConfigKey(const ConfigGroupKey& group, const char* key, T default_value):
+        group(group),
+        key(key),
+        default_value(default_value)
+    {}
+
+    QString path() const
+    {
+        return group.path().append('/').append(key);
+    }
+
+    const ConfigGroupKey& group;
+    const char* const key;
+    const T default_value;
+};
+
+class ConfigSlotBase
+{
+public:
+    virtual ~ConfigSlotBase() {}
+    virtual void update(const QVariant& value) = 0;
+};
+
+/**
+ * @brief Native value of a config item.
+ *
+ * Updated by ConfigImpl in the main thread when the item is loaded or changed.
+ * Can be read from any thread.
+ */
+template<typename T>
+class ConfigSlot: public ConfigSlotBase
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Config slot value must be trivially copyable");
+public:
+    explicit ConfigSlot(T default_value):
+        m_default_value(default_value),
+        m_value(default_value)
+    {}
+
+    T value() const
+    {
+        return m_value.load(std::memory_order_relaxed);
+    }
+
+    void update(const QVariant& value)
+    {
+        m_value.store(value.isNull() ? m_default_value : value.value<T>(), std::memory_order_relaxed);
+    }
+
+protected:
+    const T m_default_value;
+    std::atomic<T> m_value;
+};
+
+}
+
+#endif // CONFIGKEY_H
@@ -0,0 +1,28 @@
+#ifndef CONFIGKEYS_H
+#define CONFIGKEYS_H
+
+#include "configkey.h"
+#include "core.h"
+#include "configuration_items.h"
+
+namespace yasem {
+
+/**
+ * Built-in config keys. Items are created by CoreImpl::initSettings().
+ */
+namespace ConfigKeys {
+
+static constexpr ConfigGroupKey MEDIA(SETTINGS_GROUP_MEDIA);
+static constexpr ConfigGroupKey VIDEO("video", &MEDIA);
+static constexpr ConfigKey<int> VIDEO_ASPECT_RATIO(VIDEO, "aspect_ratio", SDK::ASPECT_RATIO_16_9);
+
+static constexpr ConfigGroupKey OTHER(SETTINGS_GROUP_OTHER);
+static constexpr ConfigGroupKey NETWORK_STATISTICS_GROUP(NETWORK_STATISTICS, &OTHER);
+static constexpr ConfigKey<bool> NETWORK_STATISTICS_ENABLED_KEY(NETWORK_STATISTICS_GROUP, NETWORK_STATISTICS_ENABLED, true);
+static constexpr ConfigKey<int> NETWORK_STATISTICS_SLOW_REQ_TIMEOUT_KEY(NETWORK_STATISTICS_GROUP, NETWORK_STATISTICS_SLOW_REQ_TIMEOUT, 5000);
+
+}
+
+}
+
+#endif // CONFIGKEYS_H
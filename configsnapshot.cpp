@@ -0,0 +1,208 @@
+#include "configsnapshot.h"
+#include "inifile.h"
+#include "macros.h"
+#include "logcategories.h"
+
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+
+using namespace yasem;
+
+static const quint32 CONFIG_SNAPSHOT_MAGIC = 0x47464359; // "YCFG"
+static const quint32 CONFIG_SNAPSHOT_VERSION = 1;
+
+ConfigSnapshot::ConfigSnapshot(const QString &file_name) :
+    m_file_name(file_name),
+    m_is_modified(false)
+{
+
+}
+
+ConfigSnapshot::~ConfigSnapshot()
+{
+    // Values that haven't been parsed yet point into the mapping
+    m_files.clear();
+    m_file.close();
+}
+
+/**
+ * @brief ConfigSnapshot::open
+ *
+ * Maps the snapshot and reads its table of files. Values are deserialized
+ * only when they're requested.
+ */
+bool ConfigSnapshot::open()
+{
+    m_files.clear();
+    m_file.close();
+    m_file.setFileName(m_file_name);
+
+    if(!m_file.exists())
+        return false;
+
+    if(!m_file.open(QFile::ReadOnly))
+    {
+        WARN() << "Cannot open config snapshot" << m_file_name;
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    const char* mapped = reinterpret_cast<const char*>(m_file.map(0, size));
+    QByteArray data = mapped != NULL ? QByteArray::fromRawData(mapped, int(size)) : m_file.readAll();
+
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if(magic != CONFIG_SNAPSHOT_MAGIC || version != CONFIG_SNAPSHOT_VERSION)
+    {
+        CONFIG_DEBUG() << "Config snapshot" << m_file_name << "has unsupported version" << version;
+        m_file.close();
+        return false;
+    }
+
+    for(quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++)
+    {
+        QString config_file;
+        FileEntry entry;
+        quint32 length = 0;
+        stream >> config_file >> entry.size >> entry.modified >> length;
+
+        const int offset = int(stream.device()->pos());
+        if(stream.status() != QDataStream::Ok || offset + qint64(length) > data.size())
+            break;
+
+        // Raw data is shared with the mapping, no copy is made here
+        entry.data = mapped != NULL ? QByteArray::fromRawData(mapped + offset, int(length)) : data.mid(offset, int(length));
+        entry.is_parsed = false;
+        stream.skipRawData(int(length));
+
+        m_files.insert(config_file, entry);
+    }
+
+    if(stream.status() != QDataStream::Ok)
+    {
+        WARN() << "Config snapshot" << m_file_name << "is corrupted";
+        m_files.clear();
+        m_file.close();
+        return false;
+    }
+
+    CONFIG_DEBUG() << "Config snapshot contains" << m_files.size() << "files";
+    return true;
+}
+
+/**
+ * @brief ConfigSnapshot::save
+ *
+ * Writes the snapshot if it has been modified.
+ */
+bool ConfigSnapshot::save()
+{
+    if(!m_is_modified)
+        return true;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << CONFIG_SNAPSHOT_MAGIC << CONFIG_SNAPSHOT_VERSION << quint32(m_files.size());
+
+    for(auto iterator = m_files.constBegin(); iterator != m_files.constEnd(); ++iterator)
+    {
+        QByteArray values = iterator->data;
+        if(iterator->is_parsed)
+        {
+            values.clear();
+            QDataStream values_stream(&values, QIODevice::WriteOnly);
+            values_stream.setVersion(QDataStream::Qt_5_0);
+            values_stream << iterator->values;
+        }
+
+        stream << iterator.key() << iterator->size << iterator->modified << quint32(values.size());
+        stream.writeRawData(values.constData(), values.size());
+    }
+
+    QSaveFile file(m_file_name);
+    if(!file.open(QFile::WriteOnly) || file.write(data) != data.size() || !file.commit())
+    {
+        WARN() << "Cannot write config snapshot" << m_file_name;
+        return false;
+    }
+
+    CONFIG_DEBUG() << "Config snapshot saved," << data.size() << "bytes";
+    m_is_modified = false;
+    return true;
+}
+
+bool ConfigSnapshot::isModified() const
+{
+    return m_is_modified;
+}
+
+/**
+ * @brief ConfigSnapshot::values
+ *
+ * Returns values of the config file if the file hasn't been changed since they were stored.
+ * path is the full path to the file.
+ */
+const QHash<QString, QVariant>* ConfigSnapshot::values(const QString &config_file, const QString &path)
+{
+    auto iterator = m_files.find(config_file);
+    if(iterator == m_files.end())
+        return NULL;
+
+    qint64 size = 0;
+    qint64 modified = 0;
+    if(!readFileInfo(path, size, modified) || size != iterator->size || modified != iterator->modified)
+    {
+        CONFIG_DEBUG() << "Config file" << config_file << "has been changed since snapshot";
+        return NULL;
+    }
+
+    if(!iterator->is_parsed)
+    {
+        QDataStream stream(iterator->data);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream >> iterator->values;
+        iterator->is_parsed = true;
+        iterator->data.clear();
+    }
+    return &iterator->values;
+}
+
+/**
+ * @brief ConfigSnapshot::update
+ *
+ * Replaces stored values of the config file with the values of the parsed file.
+ */
+void ConfigSnapshot::update(const QString &config_file, const IniFile &ini)
+{
+    FileEntry entry;
+    if(ini.isStale() || !readFileInfo(ini.fileName(), entry.size, entry.modified))
+    {
+        m_is_modified = m_files.remove(config_file) > 0 || m_is_modified;
+        return;
+    }
+
+    for(const QString& key: ini.keys())
+        entry.values.insert(key, ini.value(key));
+    entry.is_parsed = true;
+
+    m_files.insert(config_file, entry);
+    m_is_modified = true;
+}
+
+bool ConfigSnapshot::readFileInfo(const QString &path, qint64 &size, qint64 &modified)
+{
+    QFileInfo info(path);
+    if(!info.exists())
+        return false;
+    size = info.size();
+    modified = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
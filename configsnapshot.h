@@ -0,0 +1,54 @@
+#ifndef CONFIGSNAPSHOT_H
+#define CONFIGSNAPSHOT_H
+
+#include <QString>
+#include <QHash>
+#include <QVariant>
+#include <QFile>
+
+namespace yasem {
+
+class IniFile;
+
+/**
+ * @brief Binary cache of values read from config files.
+ *
+ * Values of every INI file are stored as serialized QVariants together with
+ * the size and modification time of the file. A file's values are used only while
+ * the file is unchanged, otherwise the file is parsed and its values are replaced.
+ * INI files remain the only source of truth, the snapshot can be deleted at any time.
+ */
+class ConfigSnapshot
+{
+public:
+    explicit ConfigSnapshot(const QString &file_name);
+    ~ConfigSnapshot();
+
+    bool open();
+    bool save();
+    bool isModified() const;
+
+    const QHash<QString, QVariant>* values(const QString &config_file, const QString &path);
+    void update(const QString &config_file, const IniFile &ini);
+
+protected:
+    struct FileEntry
+    {
+        qint64 size;
+        qint64 modified;
+        QByteArray data;                    // serialized values, may point into the mapping
+        QHash<QString, QVariant> values;
+        bool is_parsed;
+    };
+
+    static bool readFileInfo(const QString &path, qint64 &size, qint64 &modified);
+
+    QString m_file_name;
+    QFile m_file;
+    QHash<QString, FileEntry> m_files;
+    bool m_is_modified;
+};
+
+}
+
+#endif // CONFIGSNAPSHOT_H
@@ -0,0 +1,219 @@
+#include "configwritebehind.h"
+#include "settingsregistry.h"
+#include "macros.h"
+#include "logcategories.h"
+#include "inifile.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QtConcurrent>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstdio>
+#endif //Q_OS_UNIX
+
+using namespace yasem;
+
+static const int CONFIG_WRITE_DELAY = 500; // ms
+static const int CONFIG_WRITE_MAX_DELAY = 2000; // ms
+static const int CONFIG_LOCK_TIMEOUT = 5000; // ms
+static const char* const CONFIG_TEMP_SUFFIX = ".tmp";
+static const char* const CONFIG_LOCK_SUFFIX = ".lock"; // The same lock file as QSettings uses
+
+ConfigWriteBehind* ConfigWriteBehind::m_instance = NULL;
+
+ConfigWriteBehind::ConfigWriteBehind(QObject *parent) :
+    QObject(parent)
+{
+    m_instance = this;
+
+    // Files are written one by one
+    m_writer.setMaxThreadCount(1);
+
+    m_commit_timer.setSingleShot(true);
+    m_commit_timer.setInterval(CONFIG_WRITE_DELAY);
+    connect(&m_commit_timer, &QTimer::timeout, this, &ConfigWriteBehind::commit);
+    connect(&m_write_watcher, &QFutureWatcher<bool>::finished, this, &ConfigWriteBehind::onWriteFinished);
+}
+
+ConfigWriteBehind::~ConfigWriteBehind()
+{
+    flush();
+    if(m_instance == this)
+        m_instance = NULL;
+}
+
+ConfigWriteBehind* ConfigWriteBehind::instance()
+{
+    return m_instance;
+}
+
+/**
+ * @brief ConfigWriteBehind::setValue
+ *
+ * Schedules a write of the value. Changes are committed when there were no new
+ * changes for a short time, but not later than CONFIG_WRITE_MAX_DELAY after the first one.
+ */
+void ConfigWriteBehind::setValue(const QString &file_name, const QString &key, const QVariant &value)
+{
+    if(m_pending.isEmpty())
+        m_first_change.start();
+
+    m_pending[file_name].insert(key, value);
+
+    if(m_first_change.elapsed() < CONFIG_WRITE_MAX_DELAY || !m_commit_timer.isActive())
+        m_commit_timer.start();
+}
+
+/**
+ * @brief ConfigWriteBehind::pendingValue
+ *
+ * Returns a value that hasn't been written to the file yet.
+ */
+bool ConfigWriteBehind::pendingValue(const QString &file_name, const QString &key, QVariant &value) const
+{
+    for(const Changes* changes: { &m_pending, &m_writing })
+    {
+        auto file = changes->constFind(file_name);
+        if(file == changes->constEnd())
+            continue;
+
+        auto iterator = file->constFind(key);
+        if(iterator != file->constEnd())
+        {
+            value = iterator.value();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ConfigWriteBehind::hasPendingWrites() const
+{
+    return !m_pending.isEmpty() || m_write_future.isRunning();
+}
+
+/**
+ * @brief ConfigWriteBehind::commit
+ *
+ * Starts writing of pending changes in background.
+ */
+void ConfigWriteBehind::commit()
+{
+    m_commit_timer.stop();
+    if(m_pending.isEmpty()) return;
+
+    // The next commit starts when this one is finished
+    if(m_write_future.isRunning()) return;
+
+    // Shared settings must not write the same files while they're being replaced
+    SettingsRegistry::instance()->sync();
+
+    m_writing = m_pending;
+    m_pending.clear();
+
+    Changes changes = m_writing;
+    for(const QString& file_name: m_writing.keys())
+    {
+        changes.insert(SettingsRegistry::instance()->filePath(file_name), changes.take(file_name));
+    }
+
+    CONFIG_DEBUG() << "Writing config files" << changes.keys();
+    m_write_future = QtConcurrent::run(&m_writer, &ConfigWriteBehind::writeFiles, changes);
+    m_write_watcher.setFuture(m_write_future);
+}
+
+/**
+ * @brief ConfigWriteBehind::flush
+ *
+ * Writes all changes before return. Should be called before exit.
+ */
+void ConfigWriteBehind::flush()
+{
+    m_write_future.waitForFinished();
+    onWriteFinished();
+
+    commit();
+    m_write_future.waitForFinished();
+    onWriteFinished();
+}
+
+void ConfigWriteBehind::onWriteFinished()
+{
+    if(m_writing.isEmpty()) return;
+
+    if(!m_write_future.isCanceled() && !m_write_future.result())
+        WARN() << "Cannot write some of config files" << m_writing.keys();
+
+    m_writing.clear();
+
+    // Settings re-read the files that have been replaced
+    SettingsRegistry::instance()->sync();
+
+    if(!m_pending.isEmpty() && !m_commit_timer.isActive())
+        m_commit_timer.start();
+}
+
+bool ConfigWriteBehind::writeFiles(const Changes &changes)
+{
+    bool result = true;
+    for(auto iterator = changes.constBegin(); iterator != changes.constEnd(); ++iterator)
+        result = writeFile(iterator.key(), iterator.value()) && result;
+    return result;
+}
+
+/**
+ * @brief ConfigWriteBehind::writeFile
+ *
+ * Writes the file with new values into a temporary file and replaces the file with it.
+ * Runs in the writer thread.
+ *
+ * QSettings objects of plugins may sync the same file meanwhile. They hold the file's
+ * lock while they read, merge and write it, so the file is locked from reading till
+ * renaming here too. Their changes are either read here or merged by them afterwards.
+ */
+bool ConfigWriteBehind::writeFile(const QString &path, const QMap<QString, QVariant> &values)
+{
+    const QString temp_path = path + CONFIG_TEMP_SUFFIX;
+
+    QLockFile lock(path + CONFIG_LOCK_SUFFIX);
+    if(!lock.tryLock(CONFIG_LOCK_TIMEOUT))
+        return false;
+
+    {
+        // Only changed values are replaced, the rest of the file is copied as is
+        IniFile ini(path);
+        if(!ini.open())
+            return false;
+        for(auto iterator = values.constBegin(); iterator != values.constEnd(); ++iterator)
+            ini.setValue(iterator.key(), iterator.value());
+        if(!ini.save(temp_path))
+            return false;
+    }
+
+#ifdef Q_OS_UNIX
+    const QByteArray temp_name = QFile::encodeName(temp_path);
+    int fd = ::open(temp_name.constData(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    const bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    if(!synced || ::rename(temp_name.constData(), QFile::encodeName(path).constData()) != 0)
+        return false;
+
+    // Rename must reach the disk too
+    fd = ::open(QFile::encodeName(QFileInfo(path).absolutePath()).constData(), O_RDONLY);
+    if(fd >= 0)
+    {
+        ::fsync(fd);
+        ::close(fd);
+    }
+    return true;
+#else
+    QFile::remove(path);
+    return QFile::rename(temp_path, path);
+#endif //Q_OS_UNIX
+}
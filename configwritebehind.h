@@ -0,0 +1,67 @@
+#ifndef CONFIGWRITEBEHIND_H
+#define CONFIGWRITEBEHIND_H
+
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QVariant>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QThreadPool>
+
+namespace yasem {
+
+/**
+ * @brief Writes config values to files in background.
+ *
+ * Values are collected for a short time and then written by a background thread.
+ * Each file is committed atomically: the new content is written into a temporary
+ * file, synced to disk and renamed over the old one, so a power cut leaves either
+ * the old or the new file. The file is locked like QSettings locks it, so other
+ * settings objects of the same file don't lose their changes. Shared settings
+ * objects (@see SettingsRegistry) re-read the files after the write.
+ *
+ * Keys are full QSettings keys ("group/key") in files of the config directory.
+ */
+class ConfigWriteBehind : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConfigWriteBehind(QObject *parent = 0);
+    virtual ~ConfigWriteBehind();
+
+    static ConfigWriteBehind* instance();
+
+    void setValue(const QString &file_name, const QString &key, const QVariant &value);
+    bool pendingValue(const QString &file_name, const QString &key, QVariant &value) const;
+    bool hasPendingWrites() const;
+
+public slots:
+    void commit();
+    void flush();
+
+protected slots:
+    void onWriteFinished();
+
+protected:
+    typedef QHash<QString, QMap<QString, QVariant>> Changes;
+
+    static bool writeFiles(const Changes &changes);
+    static bool writeFile(const QString &path, const QMap<QString, QVariant> &values);
+
+    static ConfigWriteBehind* m_instance;
+
+    Changes m_pending;
+    Changes m_writing;
+    QTimer m_commit_timer;
+    QElapsedTimer m_first_change;
+    QThreadPool m_writer;
+    QFuture<bool> m_write_future;
+    QFutureWatcher<bool> m_write_watcher;
+};
+
+}
+
+#endif // CONFIGWRITEBEHIND_H
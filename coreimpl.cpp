@@ -4,8 +4,15 @@
 #include "macros.h"
 #include "configimpl.h"
 #include "statisticsimpl.h"
+#include "networkstatisticsimpl.h"
 #include "configuration_items.h"
 #include "systemstatistics.h"
+#include "startuptracer.h"
+#include "blockdevicereader.h"
+#include "storagemonitor.h"
+#include "logcategories.h"
+#include "settingsregistry.h"
+#include "configkeys.h"
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -20,22 +27,53 @@
 #include <QMetaEnum>
 #include <QUuid>
 #include <QFileInfoList>
+#include <QThread>
+#include <QtConcurrent>
 #if QT_VERSION >= 0x050400
 #include <QStorageInfo>
 #endif
 
 using namespace yasem;
 
+static const int STORAGE_USAGE_REFRESH_INTERVAL = 30000; // ms
+
+static void setStorageUsage(SDK::StorageInfo* storage, quint64 size, quint64 available)
+{
+    storage->size = size;
+    storage->available = available;
+    storage->used = size - available;
+    if(size > 0)
+        storage->percentComplete = ((double)storage->used / size) * 100;
+    else
+        storage->percentComplete = 0;
+}
+
+static QString storageKey(const SDK::StorageInfo* storage)
+{
+    return QString("%1 %2").arg(storage->blockDevice).arg(storage->mountPoint);
+}
+
 CoreImpl::CoreImpl(QObject *parent ):
     Core(parent),
     m_network(new NetworkImpl(this)),
     m_yasem_settings(new ConfigImpl(this)),
     m_statistics(new StatisticsImpl(this)),
+    m_storages_ready(false),
+    m_storage_future_published(false),
+    m_storage_rescan_pending(false),
+    m_storage_index(0),
+    m_storage_monitor(new StorageMonitor(this)),
     m_detected_vm(VM_NOT_SET)
 {
     Q_UNUSED(parent)
     setObjectName("Core");
 
+    connect(&m_storage_watcher, &QFutureWatcher<QList<SDK::StorageInfo*>>::finished, this, &CoreImpl::onStoragesEnumerated);
+    connect(&m_storage_usage_watcher, &QFutureWatcher<QList<StorageUsage>>::finished, this, &CoreImpl::onStorageUsageRead);
+    connect(&m_storage_usage_timer, &QTimer::timeout, this, &CoreImpl::refreshStorageUsage);
+    connect(m_storage_monitor, &StorageMonitor::storagesChanged, this, &CoreImpl::mountPointChanged);
+    m_storage_usage_timer.setInterval(STORAGE_USAGE_REFRESH_INTERVAL);
+
     parseCommandLineArgs();
     checkCmdLineArgs();
     getVM();
@@ -70,10 +108,12 @@ CoreImpl::CoreImpl(QObject *parent ):
 
     LOG() << "Using config directory" << m_config_dir;
 
-    m_app_settings = new QSettings(getConfigDir().append(CONFIG_NAME), QSettings::IniFormat, this);
+    m_settings_registry = new SettingsRegistry(m_config_dir, this);
+    m_config_writer = new ConfigWriteBehind(this);
+    m_app_settings = m_settings_registry->settings(CONFIG_NAME, true);
 
     LOG() << qPrintable(QString("Starting YASEM... Core version: %1, rev. %2").arg(version()).arg(revision()));
-    DEBUG() << "Settings directory" << QFileInfo(m_app_settings->fileName()).absoluteDir().absolutePath();
+    CORE_DEBUG() << "Settings directory" << QFileInfo(m_app_settings->fileName()).absoluteDir().absolutePath();
 
     // Save app installation id for analytics
     QString iid = m_app_settings->value("installation_id", "").toString();
@@ -83,19 +123,7 @@ CoreImpl::CoreImpl(QObject *parent ):
         iid = iid.mid(1, iid.length() - 2); // Removing {}
         m_app_settings->setValue("installation_id", iid);
     }
-    DEBUG() << "App installation ID" << iid;
-
-    // Regular expressions to extract information from hwinfo's output.
-    hwinfo_regex_list.insert(SDK::HwinfoLineTypes::TITLE,           QRegularExpression("^(\\d+):\\s+(\\w+)\\s+\\d+\\.\\d+:\\s+\\d+\\s+\\w+\n"));
-    hwinfo_regex_list.insert(SDK::HwinfoLineTypes::HARDWARE_CLASS,  QRegularExpression("Hardware Class:\\s+(\\w+)\n"));
-    hwinfo_regex_list.insert(SDK::HwinfoLineTypes::UNIQUE_ID,       QRegularExpression("Unique ID:\\s+(.*)\n"));
-    hwinfo_regex_list.insert(SDK::HwinfoLineTypes::PARENT_ID,       QRegularExpression("Parent ID:\\s+(.*)\n"));
-    hwinfo_regex_list.insert(SDK::HwinfoLineTypes::SYS_FS_ID,       QRegularExpression("SysFS ID:\\s+(.*)\n"));
-    hwinfo_regex_list.insert(SDK::HwinfoLineTypes::MODEL,           QRegularExpression("Model:\\s+\\\"(.*)\\\"\n"));
-    hwinfo_regex_list.insert(SDK::HwinfoLineTypes::VENDOR,          QRegularExpression("Vendor:\\s+(?:.*\\s+)?\\\"(.*)\\\"\n"));
-    hwinfo_regex_list.insert(SDK::HwinfoLineTypes::DEVICE,          QRegularExpression("Device:\\s+(?:.*\\s+)?\\\"(.*)\\\"\n"));
-    hwinfo_regex_list.insert(SDK::HwinfoLineTypes::REVISION,        QRegularExpression("Revision:\\s+\\\"(.*)\\\"\n"));
-    hwinfo_regex_list.insert(SDK::HwinfoLineTypes::DEVICE_FILE,     QRegularExpression("Device File:\\s+(/dev/\\w+)\n"));
+    CORE_DEBUG() << "App installation ID" << iid;
 
     //mountPointChanged();
 
@@ -105,7 +133,14 @@ CoreImpl::CoreImpl(QObject *parent ):
 
 CoreImpl::~CoreImpl()
 {
+    m_config_writer->flush();
+    m_storage_monitor->stop();
+    m_storage_usage_future.waitForFinished();
+    m_storage_future.waitForFinished();
+    if(!m_storage_future_published && m_storage_future.isFinished() && !m_storage_future.isCanceled())
+        qDeleteAll(m_storage_future.result());
     qDeleteAll(m_disks);
+    qDeleteAll(m_retired_disks);
 }
 
 QSettings *CoreImpl::settings()
@@ -113,15 +148,23 @@ QSettings *CoreImpl::settings()
     return m_app_settings;
 }
 
+/**
+ * @brief CoreImpl::settings
+ *
+ * Returns a new settings object of the file owned by the core, callers may delete it.
+ * Plugins may change groups of the object and use it from their threads, so it's never
+ * shared. Parsed files are cached by QSettings itself. Core code uses SettingsRegistry.
+ */
 QSettings *CoreImpl::settings(const QString &filename)
 {
-    return new QSettings(getConfigDir().append(filename), QSettings::IniFormat, this);
+    return new QSettings(m_settings_registry->filePath(filename), QSettings::IniFormat, this);
 }
 
 void CoreImpl::onClose()
 {
     LOG() << "onClose";
     SDK::PluginManager::instance()->deinitPlugins();
+    m_config_writer->flush();
 }
 
 void CoreImpl::initBuiltInSettingsGroup()
@@ -142,9 +185,10 @@ void CoreImpl::initSettings()
     SDK::ConfigTreeGroup* media = m_yasem_settings->getDefaultGroup(SETTINGS_GROUP_MEDIA);
     SDK::ConfigTreeGroup* other = m_yasem_settings->getDefaultGroup(SETTINGS_GROUP_OTHER);
 
-    SDK::ConfigTreeGroup* video = new SDK::ConfigTreeGroup("video", tr("Video"));
+    SDK::ConfigTreeGroup* video = new SDK::ConfigTreeGroup(ConfigKeys::VIDEO.key, tr("Video"));
 
-    SDK::ListConfigItem* aspect_ratio = new SDK::ListConfigItem("aspect_ratio", tr("Default aspect ratio"), SDK::ASPECT_RATIO_16_9);
+    SDK::ListConfigItem* aspect_ratio = new SDK::ListConfigItem(ConfigKeys::VIDEO_ASPECT_RATIO.key, tr("Default aspect ratio"),
+                                                                ConfigKeys::VIDEO_ASPECT_RATIO.default_value);
     QMap<QString, QVariant>& ar_list = aspect_ratio->options();
 
     ar_list.insert(tr("Auto"),          SDK::ASPECT_RATIO_AUTO);
@@ -165,21 +209,216 @@ void CoreImpl::initSettings()
     video->addItem(aspect_ratio);
     media->addItem(video);
 
-    SDK::ConfigTreeGroup* network_statistics     = new SDK::ConfigTreeGroup(NETWORK_STATISTICS, tr("Network statistics"));
-    SDK::ConfigItem* enable_network_statistics   = new SDK::ConfigItem(NETWORK_STATISTICS_ENABLED, tr("Enable statistics"), "true", SDK::ConfigItem::BOOL);
-    SDK::ConfigItem* slow_request_timeout        = new SDK::ConfigItem(NETWORK_STATISTICS_SLOW_REQ_TIMEOUT,
-                                                             tr("Mark request as slow if it takes, ms"), "5000", SDK::ConfigItem::INT);
+    SDK::ConfigTreeGroup* network_statistics     = new SDK::ConfigTreeGroup(ConfigKeys::NETWORK_STATISTICS_GROUP.key, tr("Network statistics"));
+    SDK::ConfigItem* enable_network_statistics   = new SDK::ConfigItem(ConfigKeys::NETWORK_STATISTICS_ENABLED_KEY.key, tr("Enable statistics"),
+                                                             ConfigKeys::NETWORK_STATISTICS_ENABLED_KEY.default_value, SDK::ConfigItem::BOOL);
+    SDK::ConfigItem* slow_request_timeout        = new SDK::ConfigItem(ConfigKeys::NETWORK_STATISTICS_SLOW_REQ_TIMEOUT_KEY.key,
+                                                             tr("Mark request as slow if it takes, ms"),
+                                                             ConfigKeys::NETWORK_STATISTICS_SLOW_REQ_TIMEOUT_KEY.default_value, SDK::ConfigItem::INT);
 
     network_statistics->addItem(enable_network_statistics);
     network_statistics->addItem(slow_request_timeout);
 
     other->addItem(network_statistics);
+
+    // Network statistics settings are read by every request since the start
+    static_cast<ConfigImpl*>(m_yasem_settings)->addPreloadHint(ConfigKeys::NETWORK_STATISTICS_GROUP.path());
 }
 
 
+/**
+ * @brief CoreImpl::mountPointChanged
+ *
+ * Starts storage enumeration in background. storagesReady() is emitted when
+ * the new list is published. If enumeration is already running, another one
+ * will be started after it finishes. Called by StorageMonitor on mount and
+ * hotplug events.
+ */
 void CoreImpl::mountPointChanged()
 {
-    m_disks.clear();
+    if(m_storage_future.isRunning())
+    {
+        m_storage_rescan_pending = true;
+        return;
+    }
+
+    m_storage_rescan_pending = false;
+    m_storage_future_published = false;
+    m_storage_future = QtConcurrent::run(this, &CoreImpl::enumerateStorages);
+    m_storage_watcher.setFuture(m_storage_future);
+}
+
+void CoreImpl::onStoragesEnumerated()
+{
+    publishStorages();
+    if(m_storage_rescan_pending)
+        mountPointChanged();
+}
+
+/**
+ * @brief CoreImpl::publishStorages
+ *
+ * Merges the result of the last enumeration into current storage list.
+ * Storages that are still present keep their objects and are updated in place,
+ * so only added, removed and changed storages are reported.
+ * Callers keep pointers they got from storages() or storageRemoved(),
+ * so removed storages are kept until the core is destroyed.
+ */
+void CoreImpl::publishStorages()
+{
+    if(m_storage_future_published || m_storage_future.isCanceled()) return;
+    m_storage_future_published = true;
+
+    QHash<QString, SDK::StorageInfo*> previous;
+    for(SDK::StorageInfo* storage: m_disks)
+        previous.insert(storageKey(storage), storage);
+
+    QList<SDK::StorageInfo*> disks;
+    QList<SDK::StorageInfo*> added;
+    QList<SDK::StorageInfo*> changed;
+
+    // Existing storages are updated in place while other threads may read them
+    QMutexLocker locker(&m_storages_mutex);
+    for(SDK::StorageInfo* storage: m_storage_future.result())
+    {
+        SDK::StorageInfo* existing = previous.take(storageKey(storage));
+        if(existing == NULL)
+        {
+            storage->index = ++m_storage_index;
+            disks.append(storage);
+            added.append(storage);
+            continue;
+        }
+
+        if(updateStorage(existing, storage))
+            changed.append(existing);
+        disks.append(existing);
+        delete storage;
+    }
+
+    // Storages removed by the previous update have been out of the list for a whole update,
+    // so nobody reads them anymore. Storages removed now are kept until the next update.
+    const QList<SDK::StorageInfo*> retired = m_retired_disks;
+    const QList<SDK::StorageInfo*> removed = previous.values();
+    m_retired_disks = removed;
+    m_disks = disks;
+    m_storages_ready = true;
+    locker.unlock();
+    qDeleteAll(retired);
+
+    for(SDK::StorageInfo* storage: removed)
+    {
+        CORE_DEBUG() << "Storage removed" << storage->toString();
+        emit storageRemoved(storage);
+    }
+    for(SDK::StorageInfo* storage: added)
+    {
+        CORE_DEBUG() << "Storage added" << storage->toString();
+        emit storageAdded(storage);
+    }
+    for(SDK::StorageInfo* storage: changed)
+        emit storageChanged(storage);
+
+    emit storagesReady();
+}
+
+/**
+ * @brief CoreImpl::updateStorage
+ *
+ * Copies storage information from source. Returns true if anything has been changed.
+ */
+bool CoreImpl::updateStorage(SDK::StorageInfo *storage, const SDK::StorageInfo *source)
+{
+    bool changed = storage->size != source->size
+            || storage->available != source->available
+            || storage->model != source->model
+            || storage->vendor != source->vendor;
+
+    storage->size = source->size;
+    storage->available = source->available;
+    storage->used = source->used;
+    storage->percentComplete = source->percentComplete;
+    storage->model = source->model;
+    storage->vendor = source->vendor;
+    return changed;
+}
+
+/**
+ * @brief CoreImpl::refreshStorageUsage
+ *
+ * Reads free space of mounted storages in background.
+ * Mount and hotplug events are handled by StorageMonitor, so only usage is polled.
+ */
+void CoreImpl::refreshStorageUsage()
+{
+    if(m_storage_usage_future.isRunning() || m_storage_future.isRunning()) return;
+
+    QStringList mount_points;
+    for(SDK::StorageInfo* storage: m_disks)
+    {
+        if(!storage->mountPoint.isEmpty())
+            mount_points.append(storage->mountPoint);
+    }
+
+    if(mount_points.isEmpty()) return;
+
+    m_storage_usage_future = QtConcurrent::run(&StorageMonitor::readUsageList, mount_points);
+    m_storage_usage_watcher.setFuture(m_storage_usage_future);
+}
+
+void CoreImpl::onStorageUsageRead()
+{
+    if(m_storage_usage_future.isCanceled()) return;
+
+    // Storages are read by other threads through storages()
+    QList<SDK::StorageInfo*> changed;
+    {
+        QMutexLocker locker(&m_storages_mutex);
+        for(const StorageUsage& usage: m_storage_usage_future.result())
+        {
+            for(SDK::StorageInfo* storage: m_disks)
+            {
+                if(storage->mountPoint != usage.mount_point)
+                    continue;
+
+                if((quint64)storage->size != usage.size || (quint64)storage->available != usage.available)
+                {
+                    setStorageUsage(storage, usage.size, usage.available);
+                    changed.append(storage);
+                }
+                break;
+            }
+        }
+    }
+
+    for(SDK::StorageInfo* storage: changed)
+        emit storageChanged(storage);
+}
+
+/**
+ * @brief CoreImpl::waitForStorages
+ *
+ * Blocks until the running storage enumeration is finished and publishes its result.
+ * Should be called from the main thread.
+ */
+void CoreImpl::waitForStorages()
+{
+    if(m_storage_future.isStarted())
+    {
+        m_storage_future.waitForFinished();
+        publishStorages();
+    }
+}
+
+bool CoreImpl::isStorageListReady() const
+{
+    QMutexLocker locker(&m_storages_mutex);
+    return m_storages_ready;
+}
+
+QList<SDK::StorageInfo*> CoreImpl::enumerateStorages()
+{
+    QList<SDK::StorageInfo*> disks;
     int counter = 1;
 
 #if QT_VERSION >= 0x050400
@@ -191,19 +430,13 @@ void CoreImpl::mountPointChanged()
         info->index = counter;
         info->blockDevice = drive.device();
         info->mountPoint = drive.rootPath();
-        info->size = drive.bytesTotal();
-        info->available = drive.bytesAvailable();
-        info->used = info->size - info->available;
-        if(info->size > 0)
-            info->percentComplete = ((double)info->used / info->size) * 100;
-        else
-            info->percentComplete = 0;
+        setStorageUsage(info, drive.bytesTotal(), drive.bytesAvailable());
 
         info->model = drive.displayName();
 
-        m_disks.append(info);
+        disks.append(info);
 
-        DEBUG() << info->toString();
+        CORE_DEBUG() << info->toString();
 
         counter++;
     }
@@ -214,12 +447,12 @@ void CoreImpl::mountPointChanged()
 
     df.start("df");
     if (!df.waitForStarted())
-           return;
+           return disks;
 
     if (!df.waitForFinished())
     {
         qWarning() << "Not finished!";
-        return;
+        return disks;
     }
 
     QByteArray result;
@@ -238,9 +471,9 @@ void CoreImpl::mountPointChanged()
             info->available = matcher.captured(4).toLong();
             info->percentComplete = matcher.captured(5).toInt();
             info->mountPoint = matcher.captured(6);
-            m_disks.append(info);
+            disks.append(info);
 
-            DEBUG() << info->toString();
+            CORE_DEBUG() << info->toString();
 
             counter++;
         }
@@ -254,139 +487,103 @@ void CoreImpl::mountPointChanged()
     }
 
     df.waitForFinished();
-
-    buildBlockDeviceTree();
-
-    for(SDK::StorageInfo* disk: m_disks)
-    {
-        QString device = disk->blockDevice;
-        for(SDK::BlockDeviceInfo* block_device: block_device_tree)
-        {
-            if(device.startsWith(block_device->device_file))
-            {
-                disk->model = block_device->device;
-                disk->vendor = block_device->vendor;
-                break;
-            }
-        }
-    }
 #endif // defined(Q_OS_LINUX) || defined(Q_OS_DARWIN)
 #endif
-}
 
+#ifdef Q_OS_LINUX
+    // Storages are matched to sysfs devices by device number (major:minor) of their mounts,
+    // so mounts of /dev/root, symlinks or /dev/disk/by-uuid/... are matched too
+    QHash<QString, SDK::BlockDeviceInfo*> devices;
+    BlockDeviceTree tree = buildBlockDeviceTree(devices);
 
-/**
- * @brief CoreImpl::buildBlockDeviceTree
- *
- * Builds block device tree.
- *
- * This method required hwinfo to be installed.
- */
-void CoreImpl::buildBlockDeviceTree()
-{
-    DEBUG() << "updateDisksExtraInfo";
+    QHash<QString, QString> mount_devices;
+    for(const MountInfo& mount: BlockDeviceReader().readMounts())
+    {
+        // The last mount of a mount point is the visible one
+        mount_devices.insert(mount.mount_point, mount.device);
+    }
 
-#if defined(Q_OS_LINUX) || defined(Q_OS_DARWIN)
+    for(SDK::StorageInfo* disk: disks)
+    {
+        SDK::BlockDeviceInfo* block_device = devices.value(mount_devices.value(disk->mountPoint), NULL);
+        if(block_device == NULL) continue;
 
-    QProcess hwinfo;
-    hwinfo.start("hwinfo", QStringList() << "--block" );
-    if (!hwinfo.waitForStarted())
-           return;
+        // Keep volume name from QStorageInfo::displayName()
+        if(disk->model.isEmpty())
+            disk->model = block_device->device;
+        disk->vendor = block_device->vendor;
+    }
 
-    if (!hwinfo.waitForFinished())
+    // Items of the previous tree belong to the main thread
     {
-        qWarning() << "Not finished!";
-        return;
+        QMutexLocker locker(&m_storages_mutex);
+        tree.swap(block_device_tree);
     }
-
-    QString result = QString(hwinfo.readAll());
-
-    hwinfo.close();
-    hwinfo.kill();
-    if(hwinfo.state() != QProcess::NotRunning)
+    for(SDK::BlockDeviceInfo* disk: tree)
     {
-        hwinfo.terminate();
+        for(SDK::BlockDeviceInfo* partition: disk->children)
+            partition->deleteLater();
+        disk->deleteLater();
     }
+#endif // Q_OS_LINUX
 
-    hwinfo.waitForFinished();
+    return disks;
+}
 
-    // Parsing output
-    QStringList data = result.split("\n\n");
+/**
+ * @brief CoreImpl::buildBlockDeviceTree
+ *
+ * Builds block device tree from sysfs (@see BlockDeviceReader).
+ * Called from the storage enumeration thread, so the tree is built aside
+ * and the caller replaces block_device_tree with it under m_storages_mutex.
+ * Disks and partitions are also returned by device number, partitions map to their disks.
+ */
+CoreImpl::BlockDeviceTree CoreImpl::buildBlockDeviceTree(QHash<QString, SDK::BlockDeviceInfo*> &devices)
+{
+    CORE_DEBUG() << "buildBlockDeviceTree";
 
-    block_device_tree.clear();
-    for(QString part_data: data)
+    BlockDeviceTree tree;
+#ifdef Q_OS_LINUX
+    BlockDeviceReader reader;
+    int index = 1;
+    for(const BlockDevice& disk: reader.readDisks())
     {
-        SDK::BlockDeviceInfo* block_device = new SDK::BlockDeviceInfo(this);
-        for(SDK::HwinfoLineTypes index: hwinfo_regex_list.keys())
-        {
-            QRegularExpressionMatch matcher = hwinfo_regex_list.value(index).match(part_data);
-            if(matcher.hasMatch())
-            {
-                switch(index) {
-                    case SDK::HwinfoLineTypes::TITLE: {
-                        block_device->m_index = matcher.captured(1).toInt();
-                        break;
-                    }
-                    case SDK::HwinfoLineTypes::HARDWARE_CLASS: {
-                        QString hw_class_name = matcher.captured(1);
-                        if(hw_class_name == "disk")
-                            block_device->m_hardware_type = SDK::BlockDeviceType::DEVICE_TYPE_DISK;
-                        else if(hw_class_name == "partition")
-                            block_device->m_hardware_type = SDK::BlockDeviceType::DEVICE_TYPE_PARTITION;
-                        else if(hw_class_name == "cdrom")
-                            block_device->m_hardware_type = SDK::BlockDeviceType::DEVICE_TYPE_CD_ROM;
-                        else
-                            block_device->m_hardware_type = SDK::BlockDeviceType::DEVICE_TYPE_UNKNOWN;
-                        break;
-                    }
-                    case SDK::HwinfoLineTypes::UNIQUE_ID: {
-                        block_device->unique_id = matcher.captured(1);
-                        break;
-                    }
-                    case SDK::HwinfoLineTypes::PARENT_ID: {
-                        block_device->parent_id = matcher.captured(1);
-                        break;
-                    }
-                    case SDK::HwinfoLineTypes::SYS_FS_ID: {
-                        block_device->sys_fs_id = matcher.captured(1);
-                        break;
-                    }
-                    case SDK::HwinfoLineTypes::MODEL: {
-                        block_device->model = matcher.captured(1);
-                        break;
-                    }
-                    case SDK::HwinfoLineTypes::VENDOR: {
-                        block_device->vendor = matcher.captured(1);
-                        break;
-                    }
-                    case SDK::HwinfoLineTypes::DEVICE: {
-                        block_device->device = matcher.captured(1);
-                        break;
-                    }
-                    case SDK::HwinfoLineTypes::REVISION: {
-                        block_device->revision = matcher.captured(1);
-                        break;
-                    }
-                    case SDK::HwinfoLineTypes::DEVICE_FILE: {
-                        block_device->device_file = matcher.captured(1);
-                        break;
-                    }
-                }
-            }
-        }
+        SDK::BlockDeviceInfo* disk_info = createBlockDeviceInfo(disk, index++);
+        disk_info->m_hardware_type = disk.cdrom ? SDK::DEVICE_TYPE_CD_ROM : SDK::DEVICE_TYPE_DISK;
+        devices.insert(disk.device, disk_info);
+        CORE_DEBUG() << "block device" << disk_info->toString();
 
-        DEBUG() << "block device" << block_device->toString();
-        if(block_device->m_hardware_type == SDK::DEVICE_TYPE_DISK)
+        for(const BlockDevice& partition: disk.partitions)
         {
-            block_device_tree.insert(block_device->unique_id, block_device);
-        }
-        else if(block_device->m_hardware_type == SDK::DEVICE_TYPE_PARTITION)
-        {
-            block_device_tree.value(block_device->parent_id)->children.append(block_device);
+            SDK::BlockDeviceInfo* partition_info = createBlockDeviceInfo(partition, index++);
+            partition_info->m_hardware_type = SDK::DEVICE_TYPE_PARTITION;
+            partition_info->parent_id = disk_info->unique_id;
+            disk_info->children.append(partition_info);
+            devices.insert(partition.device, disk_info);
+            CORE_DEBUG() << "block device" << partition_info->toString();
         }
+
+        tree.insert(disk_info->unique_id, disk_info);
     }
-#endif // defined(Q_OS_LINUX) || defined(Q_OS_DARWIN)
+#endif // Q_OS_LINUX
+    return tree;
+}
 
+SDK::BlockDeviceInfo* CoreImpl::createBlockDeviceInfo(const BlockDevice &device, int index)
+{
+    // Runs in a worker thread, so the object can't have a parent from the main thread
+    SDK::BlockDeviceInfo* info = new SDK::BlockDeviceInfo(NULL);
+    info->moveToThread(thread());
+
+    info->m_index = index;
+    info->unique_id = device.name;
+    info->sys_fs_id = device.sys_path;
+    info->model = device.model;
+    info->vendor = device.vendor;
+    info->device = device.model;
+    info->revision = device.revision;
+    info->device_file = device.device_file;
+    return info;
 }
 
 void CoreImpl::checkCmdLineArgs()
@@ -420,18 +617,64 @@ void CoreImpl::printHelp()
     INFO() << "    "
            << qPrintable(QString("--log=<file name>").leftJustified(width, ' '))
            << "Write log into a file.";
+    INFO() << "    "
+           << qPrintable(QString("--log-max-size=<KB>").leftJustified(width, ' '))
+           << "Rotate log file when it's larger than the size (10240 KB by default, 0 - unlimited).";
+    INFO() << "    "
+           << qPrintable(QString("--log-max-age=<hours>").leftJustified(width, ' '))
+           << "Rotate log file when it's older than the age (0 - never, by default).";
+    INFO() << "    "
+           << qPrintable(QString("--log-keep=<count>").leftJustified(width, ' '))
+           << "Number of compressed rotated log files to keep (5 by default).";
+    INFO() << "    "
+           << qPrintable(QString("--log-binary=<file name>").leftJustified(width, ' '))
+           << "Write log into a binary ring file of fixed size. Use logdecoder tool to read it.";
+    INFO() << "    "
+           << qPrintable(QString("--log-binary-size=<KB>").leftJustified(width, ' '))
+           << "Size of the binary log file (1024 KB by default).";
+    INFO() << "    "
+           << qPrintable(QString("--log-level=<[category:]level,...>").leftJustified(width, ' '))
+           << "Set log level (debug, info, warning, critical) for all or given categories: core, plugins, profiles, config, network, plugin.<id>.";
     INFO() << "    "
            << qPrintable(QString("--window-size=<size or auto>").leftJustified(width, ' '))
            << "Set window size to WIDTHxHEIGHT (e.g. 1920x1080) or auto (fill screen). To fill the screen use with --fullscreen option.";
     INFO() << "    "
            << qPrintable(QString("--no-opengl").leftJustified(width, ' '))
            << "Disable OpenGL rendering.";
+    INFO() << "    "
+           << qPrintable(QString("--crash-dump=<file name>").leftJustified(width, ' '))
+           << "Write registers, stack and the last log lines into a file on crash (Linux only).";
+    INFO() << "    "
+           << qPrintable(QString("--raw-backtrace").leftJustified(width, ' '))
+           << "Print call stacks as module+offset for offline symbolization (Linux only).";
+    INFO() << "    "
+           << qPrintable(QString("--no-parallel-init").leftJustified(width, ' '))
+           << "Initialize all plugins one by one in the main thread.";
+    INFO() << "    "
+           << qPrintable(QString("--profile-cpu=<file name>").leftJustified(width, ' '))
+           << "Sample call stacks of the main and plugin threads and write them in folded format for flame graphs at exit or on SIGUSR2 (Linux only).";
+    INFO() << "    "
+           << qPrintable(QString("--profile-cpu-frequency=<Hz>").leftJustified(width, ' '))
+           << "Sampling frequency of the CPU profiler (100 by default).";
+    INFO() << "    "
+           << qPrintable(QString("--startup-trace=<file name>").leftJustified(width, ' '))
+           << "Write startup timeline into a file in Chrome trace format.";
 
     exit(0);
 }
 
+/**
+ * @brief CoreImpl::storages
+ *
+ * Returns the last published list of storages. If nothing has been published yet,
+ * main thread waits for the first enumeration to finish.
+ */
 QList<SDK::StorageInfo *> CoreImpl::storages()
 {
+    if(!isStorageListReady() && QThread::currentThread() == thread())
+        waitForStorages();
+
+    QMutexLocker locker(&m_storages_mutex);
     return m_disks;
 }
 
@@ -525,7 +768,17 @@ SDK::Statistics *CoreImpl::statistics() const
 
 void yasem::CoreImpl::init()
 {
-    m_yasem_settings->load();
+    {
+        // Other containers are loaded on first access
+        StartupTraceScope trace("ConfigImpl::preload");
+        static_cast<ConfigImpl*>(m_yasem_settings)->preload();
+    }
+    // Statistics read their settings on every request without lookups
+    static_cast<NetworkStatisticsImpl*>(statistics()->network())->bindConfig(static_cast<ConfigImpl*>(m_yasem_settings));
+
+    // Storage list is updated on mount and hotplug events instead of full rescans by callers
+    if(m_storage_monitor->start())
+        m_storage_usage_timer.start();
     statistics()->system()->print();
 }
 
@@ -2,9 +2,17 @@
 #define COREIMPL_H
 
 #include "core.h"
+#include "blockdevicereader.h"
+#include "storagemonitor.h"
+#include "settingsregistry.h"
+#include "configwritebehind.h"
 #include <QObject>
 #include <QPointer>
 #include <QScopedPointer>
+#include <QMutex>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QTimer>
 
 namespace yasem {
 
@@ -31,32 +39,66 @@ public:
     VirtualMachine getVM() Q_DECL_OVERRIDE;
     bool featureAvailable(const Feature feature) const Q_DECL_OVERRIDE;
 
+    void waitForStorages();
+    bool isStorageListReady() const;
+
     // Core interface
     Q_INVOKABLE QString version() const Q_DECL_OVERRIDE;
     Q_INVOKABLE QString revision() const Q_DECL_OVERRIDE;
     Q_INVOKABLE QString compiler() const Q_DECL_OVERRIDE;
     Q_INVOKABLE QString getConfigDir() const Q_DECL_OVERRIDE;
 
+signals:
+    void storagesReady();
+    void storageAdded(SDK::StorageInfo* storage);
+    void storageRemoved(SDK::StorageInfo* storage);
+    void storageChanged(SDK::StorageInfo* storage);
+
 public slots:
     void onClose() Q_DECL_OVERRIDE;
     void mountPointChanged() Q_DECL_OVERRIDE;
 
     QThread* mainThread() Q_DECL_OVERRIDE;
 
+protected slots:
+    void onStoragesEnumerated();
+    void refreshStorageUsage();
+    void onStorageUsageRead();
+
 protected:
     void parseCommandLineArgs() Q_DECL_OVERRIDE;
     void initBuiltInSettingsGroup();
     void initSettings();
     void fillKeymapHashTable();
-    void buildBlockDeviceTree();
+    typedef decltype(block_device_tree) BlockDeviceTree;
+    BlockDeviceTree buildBlockDeviceTree(QHash<QString, SDK::BlockDeviceInfo*> &devices);
+    SDK::BlockDeviceInfo* createBlockDeviceInfo(const BlockDevice& device, int index);
+    QList<SDK::StorageInfo*> enumerateStorages();
+    void publishStorages();
+    bool updateStorage(SDK::StorageInfo* storage, const SDK::StorageInfo* source);
     void checkCmdLineArgs();
     void printHelp();
 
+    SettingsRegistry* m_settings_registry;
+    ConfigWriteBehind* m_config_writer;
     QSettings* m_app_settings;
     SDK::CoreNetwork* m_network;
     SDK::Config* m_yasem_settings;
     SDK::Statistics* m_statistics;
     QList<SDK::StorageInfo *> m_disks;
+    // Removed by the last update, receivers of storageRemoved() may still use them
+    QList<SDK::StorageInfo *> m_retired_disks;
+    mutable QMutex m_storages_mutex;
+    bool m_storages_ready;
+    QFuture<QList<SDK::StorageInfo*>> m_storage_future;
+    QFutureWatcher<QList<SDK::StorageInfo*>> m_storage_watcher;
+    bool m_storage_future_published;
+    bool m_storage_rescan_pending;
+    int m_storage_index;
+    StorageMonitor* m_storage_monitor;
+    QTimer m_storage_usage_timer;
+    QFuture<QList<StorageUsage>> m_storage_usage_future;
+    QFutureWatcher<QList<StorageUsage>> m_storage_usage_watcher;
     Features m_features;
 
     QString m_config_dir;
@@ -0,0 +1,312 @@
+#include "cpuprofiler.h"
+#include "macros.h"
+#include "stacktrace.h"
+
+#include <QFile>
+#include <QHash>
+#include <QTimer>
+#include <QCoreApplication>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
+#define CPU_PROFILER_SUPPORTED
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <execinfo.h>
+#include <sys/syscall.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif // Q_OS_LINUX
+
+using namespace yasem;
+
+static const int CPU_PROFILER_DEFAULT_FREQUENCY = 100; // Hz
+static const int CPU_PROFILER_MAX_SAMPLES = 32768; // Power of two, the buffer is a ring
+static const int CPU_PROFILER_MAX_FRAMES = 32;
+static const int CPU_PROFILER_SKIP_FRAMES = 2; // Signal handler and signal trampoline
+static const int CPU_PROFILER_DUMP_CHECK_INTERVAL = 1000; // ms
+
+struct CpuProfilerSample
+{
+    // Position of the sample plus one, 0 while the sample is being written
+    std::atomic<quint64> sequence;
+    int thread_index;
+    int depth;
+    void* frames[CPU_PROFILER_MAX_FRAMES];
+};
+
+static CpuProfilerSample* s_samples = NULL;
+static std::atomic<quint64> s_sample_count(0);
+static std::atomic<bool> s_dump_requested(false);
+static __thread int t_thread_index = -1;
+
+#ifdef CPU_PROFILER_SUPPORTED
+static void profilerSignalHandler(int signal, siginfo_t* info, void* context)
+{
+    Q_UNUSED(signal)
+    Q_UNUSED(info)
+    Q_UNUSED(context)
+
+    if(t_thread_index < 0) return;
+
+    const int saved_errno = errno;
+    void* frames[CPU_PROFILER_MAX_FRAMES + CPU_PROFILER_SKIP_FRAMES];
+    const int depth = backtrace(frames, CPU_PROFILER_MAX_FRAMES + CPU_PROFILER_SKIP_FRAMES);
+
+    // The oldest sample is overwritten when the buffer is full
+    const quint64 position = s_sample_count.fetch_add(1, std::memory_order_relaxed);
+    CpuProfilerSample& sample = s_samples[position & (CPU_PROFILER_MAX_SAMPLES - 1)];
+    sample.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    sample.thread_index = t_thread_index;
+    sample.depth = qMax(0, depth - CPU_PROFILER_SKIP_FRAMES);
+    for(int frame = 0; frame < sample.depth; frame++)
+        sample.frames[frame] = frames[frame + CPU_PROFILER_SKIP_FRAMES];
+    sample.sequence.store(position + 1, std::memory_order_release);
+    errno = saved_errno;
+}
+
+static void profilerDumpHandler(int signal)
+{
+    Q_UNUSED(signal)
+    s_dump_requested.store(true, std::memory_order_relaxed);
+}
+#endif // CPU_PROFILER_SUPPORTED
+
+CpuProfiler::CpuProfiler():
+    m_enabled(false),
+    m_frequency(CPU_PROFILER_DEFAULT_FREQUENCY)
+{
+
+}
+
+CpuProfiler* CpuProfiler::instance()
+{
+    static CpuProfiler profiler;
+    return &profiler;
+}
+
+/**
+ * @brief CpuProfiler::init
+ *
+ * Should be called from the main thread after the application has been created.
+ * The main thread is registered by itself.
+ */
+void CpuProfiler::init(const QStringList &arguments)
+{
+    for(const QString& arg: arguments)
+    {
+        if(arg.startsWith("--profile-cpu="))
+            m_file_name = arg.mid(arg.indexOf('=') + 1);
+        else if(arg.startsWith("--profile-cpu-frequency="))
+            m_frequency = qBound(1, arg.mid(arg.indexOf('=') + 1).toInt(), 1000);
+    }
+
+    if(m_file_name.isEmpty()) return;
+
+#ifdef CPU_PROFILER_SUPPORTED
+    s_samples = new CpuProfilerSample[CPU_PROFILER_MAX_SAMPLES];
+    for(int index = 0; index < CPU_PROFILER_MAX_SAMPLES; index++)
+        s_samples[index].sequence.store(0, std::memory_order_relaxed);
+
+    // backtrace() loads libgcc on the first call, that's not safe in a signal handler
+    void* frames[CPU_PROFILER_MAX_FRAMES];
+    backtrace(frames, CPU_PROFILER_MAX_FRAMES);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = &profilerSignalHandler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    struct sigaction dump_action;
+    memset(&dump_action, 0, sizeof(dump_action));
+    dump_action.sa_handler = &profilerDumpHandler;
+    dump_action.sa_flags = SA_RESTART;
+    sigemptyset(&dump_action.sa_mask);
+    sigaction(SIGUSR2, &dump_action, NULL);
+
+    // Profile can't be written from the signal handler
+    QTimer* dump_timer = new QTimer(qApp);
+    dump_timer->setInterval(CPU_PROFILER_DUMP_CHECK_INTERVAL);
+    QObject::connect(dump_timer, &QTimer::timeout, [this]() {
+        if(s_dump_requested.exchange(false))
+            writeProfile();
+    });
+    dump_timer->start();
+
+    m_enabled = true;
+    LOG() << "CPU profiler is enabled," << m_frequency << "samples per second. Profile will be written into" << m_file_name;
+
+    registerThread("main");
+#else
+    WARN() << "CPU profiler is not supported on this platform";
+#endif // CPU_PROFILER_SUPPORTED
+}
+
+bool CpuProfiler::isEnabled() const
+{
+    return m_enabled;
+}
+
+/**
+ * @brief CpuProfiler::registerThread
+ *
+ * Starts sampling of the calling thread.
+ */
+void CpuProfiler::registerThread(const QString &name)
+{
+    if(!m_enabled || t_thread_index >= 0) return;
+
+#ifdef CPU_PROFILER_SUPPORTED
+    QMutexLocker locker(&m_mutex);
+    t_thread_index = m_thread_names.size();
+    m_thread_names.append(QString(name).replace(';', '_').replace(' ', '_'));
+
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = syscall(SYS_gettid);
+
+    timer_t timer;
+    if(timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer) != 0)
+    {
+        WARN() << "Cannot create profiler timer for thread" << name;
+        return;
+    }
+
+    // tv_nsec must be less than a second, 1 Hz is a whole second
+    const long interval_ns = 1000000000L / m_frequency;
+    struct itimerspec interval;
+    interval.it_interval.tv_sec = interval_ns / 1000000000L;
+    interval.it_interval.tv_nsec = interval_ns % 1000000000L;
+    interval.it_value = interval.it_interval;
+    if(timer_settime(timer, 0, &interval, NULL) != 0)
+    {
+        WARN() << "Cannot start profiler timer for thread" << name << ":" << strerror(errno);
+        timer_delete(timer);
+        return;
+    }
+
+    ThreadTimer thread_timer;
+    thread_timer.thread_index = t_thread_index;
+    thread_timer.timer = timer;
+    m_timers.append(thread_timer);
+#else
+    Q_UNUSED(name)
+#endif // CPU_PROFILER_SUPPORTED
+}
+
+/**
+ * @brief CpuProfiler::unregisterThread
+ *
+ * Stops sampling of the calling thread. Should be called before the thread exits.
+ */
+void CpuProfiler::unregisterThread()
+{
+    if(!m_enabled || t_thread_index < 0) return;
+
+#ifdef CPU_PROFILER_SUPPORTED
+    QMutexLocker locker(&m_mutex);
+    for(int index = 0; index < m_timers.size(); index++)
+    {
+        if(m_timers.at(index).thread_index == t_thread_index)
+        {
+            timer_delete((timer_t) m_timers.at(index).timer);
+            m_timers.removeAt(index);
+            break;
+        }
+    }
+#endif // CPU_PROFILER_SUPPORTED
+    t_thread_index = -1;
+}
+
+/**
+ * @brief CpuProfiler::writeProfile
+ *
+ * Writes samples in folded stacks format. The buffer is a ring,
+ * so only the latest CPU_PROFILER_MAX_SAMPLES samples are written.
+ */
+bool CpuProfiler::writeProfile()
+{
+    if(!m_enabled) return false;
+
+    QHash<QByteArray, int> stacks;
+    QHash<void*, QByteArray> names;
+    const quint64 total = s_sample_count.load(std::memory_order_acquire);
+    int count = 0;
+
+    QStringList thread_names;
+    {
+        QMutexLocker locker(&m_mutex);
+        thread_names = m_thread_names;
+    }
+
+    for(int index = 0; index < CPU_PROFILER_MAX_SAMPLES; index++)
+    {
+        // Samples are written while they're read, a copy is valid if its sequence hasn't changed
+        const CpuProfilerSample& slot = s_samples[index];
+        const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        if(sequence == 0)
+            continue;
+
+        CpuProfilerSample sample;
+        sample.thread_index = slot.thread_index;
+        sample.depth = qBound(0, slot.depth, CPU_PROFILER_MAX_FRAMES);
+        memcpy(sample.frames, slot.frames, sample.depth * sizeof(void*));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+        count++;
+
+        QByteArray stack = thread_names.value(sample.thread_index).toUtf8();
+        for(int frame = sample.depth - 1; frame >= 0; frame--)
+        {
+            void* address = sample.frames[frame];
+            auto iterator = names.constFind(address);
+            if(iterator == names.constEnd())
+                iterator = names.insert(address, QByteArray::fromStdString(FrameName(address)).replace(';', ':'));
+            stack.append(';').append(iterator.value());
+        }
+        stacks[stack]++;
+    }
+
+    QFile file(m_file_name);
+    if(!file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        WARN() << "Cannot write CPU profile into" << m_file_name;
+        return false;
+    }
+
+    for(auto iterator = stacks.constBegin(); iterator != stacks.constEnd(); ++iterator)
+        file.write(iterator.key() + ' ' + QByteArray::number(iterator.value()) + '\n');
+
+    LOG() << "CPU profile has been written into" << m_file_name << ":" << count << "samples,"
+          << (total > (quint64)CPU_PROFILER_MAX_SAMPLES ? total - CPU_PROFILER_MAX_SAMPLES : 0) << "overwritten";
+    return true;
+}
+
+void CpuProfiler::finish()
+{
+    if(!m_enabled) return;
+
+#ifdef CPU_PROFILER_SUPPORTED
+    {
+        QMutexLocker locker(&m_mutex);
+        for(const ThreadTimer& thread_timer: m_timers)
+            timer_delete((timer_t) thread_timer.timer);
+        m_timers.clear();
+    }
+#endif // CPU_PROFILER_SUPPORTED
+
+    writeProfile();
+}
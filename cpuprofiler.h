@@ -0,0 +1,56 @@
+#ifndef CPUPROFILER_H
+#define CPUPROFILER_H
+
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+#include <QList>
+
+namespace yasem {
+
+/**
+ * @brief Sampling CPU profiler.
+ *
+ * Enabled with --profile-cpu=<file>. Each registered thread gets a CPU time timer
+ * (timer_create() with SIGEV_THREAD_ID) that sends SIGPROF to that thread only.
+ * The signal handler stores raw frames into a preallocated ring buffer without locks,
+ * so the profile covers the latest samples.
+ * Stacks are symbolized and written in folded format ("thread;root;...;leaf count",
+ * see FlameGraph's flamegraph.pl) by writeProfile() at exit or on SIGUSR2.
+ *
+ * Only available on Linux.
+ */
+class CpuProfiler
+{
+public:
+    static CpuProfiler* instance();
+
+    void init(const QStringList &arguments);
+    bool isEnabled() const;
+
+    void registerThread(const QString &name);
+    void unregisterThread();
+
+    bool writeProfile();
+    void finish();
+
+protected:
+    CpuProfiler();
+
+    struct ThreadTimer
+    {
+        int thread_index;
+        void* timer;
+    };
+
+    bool m_enabled;
+    QString m_file_name;
+    int m_frequency;
+    QMutex m_mutex;
+    QStringList m_thread_names;
+    QList<ThreadTimer> m_timers;
+};
+
+}
+
+#endif // CPUPROFILER_H
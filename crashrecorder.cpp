@@ -0,0 +1,367 @@
+#include "crashrecorder.h"
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+
+#if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
+#define CRASH_RECORDER_HANDLER
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <ucontext.h>
+#endif
+
+using namespace yasem;
+
+static const int CRASH_RECORDER_SLOTS = 256;
+static const int CRASH_RECORDER_SLOT_SIZE = 256;
+
+struct CrashRecorderSlot
+{
+    std::atomic<quint32> sequence;  // 0 while the slot is being written
+    quint16 length;
+    char text[CRASH_RECORDER_SLOT_SIZE];
+};
+
+static CrashRecorderSlot s_slots[CRASH_RECORDER_SLOTS];
+static std::atomic<quint32> s_next_sequence(0);
+
+/**
+ * @brief CrashRecorder::record
+ *
+ * Copies a formatted log line into the ring. Long lines are truncated.
+ */
+void CrashRecorder::record(const QByteArray &line)
+{
+    const quint32 sequence = s_next_sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    CrashRecorderSlot& slot = s_slots[(sequence - 1) % CRASH_RECORDER_SLOTS];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    slot.length = (quint16) qMin(line.size(), CRASH_RECORDER_SLOT_SIZE);
+    memcpy(slot.text, line.constData(), slot.length);
+    slot.sequence.store(sequence, std::memory_order_release);
+}
+
+#ifdef CRASH_RECORDER_HANDLER
+
+static const int CRASH_SIGNALS[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+static const int CRASH_SIGNAL_COUNT = sizeof(CRASH_SIGNALS) / sizeof(CRASH_SIGNALS[0]);
+static const size_t CRASH_STACK_DUMP_SIZE = 16 * 1024;
+static const size_t CRASH_ALT_STACK_SIZE = 64 * 1024;
+
+static char s_dump_file[1024];
+static struct sigaction s_previous_actions[CRASH_SIGNAL_COUNT];
+static std::atomic<bool> s_crashed(false);
+
+// Stack of the current thread, known only for threads that called installThread()
+static __thread uintptr_t t_stack_low = 0;
+static __thread uintptr_t t_stack_high = 0;
+
+/*
+ * Alternate signal stack of a thread. It's unregistered and freed when the thread exits,
+ * so short-lived worker threads don't leak it.
+ */
+class CrashAltStack
+{
+public:
+    CrashAltStack(): m_memory(NULL) {}
+
+    ~CrashAltStack()
+    {
+        if(m_memory == NULL) return;
+
+        stack_t stack;
+        memset(&stack, 0, sizeof(stack));
+        stack.ss_flags = SS_DISABLE;
+        // Fails if the thread is running on the stack right now, then it must stay allocated
+        if(sigaltstack(&stack, NULL) == 0)
+            free(m_memory);
+    }
+
+    void install()
+    {
+        if(m_memory != NULL) return;
+
+        m_memory = malloc(CRASH_ALT_STACK_SIZE);
+        if(m_memory == NULL) return;
+
+        stack_t stack;
+        stack.ss_sp = m_memory;
+        stack.ss_size = CRASH_ALT_STACK_SIZE;
+        stack.ss_flags = 0;
+        if(sigaltstack(&stack, NULL) != 0)
+        {
+            free(m_memory);
+            m_memory = NULL;
+        }
+    }
+
+protected:
+    void* m_memory;
+};
+
+static thread_local CrashAltStack t_alt_stack;
+
+/*
+ * Async-signal-safe output helpers: no stdio, no allocations.
+ */
+static void writeText(int fd, const char* text)
+{
+    size_t length = strlen(text);
+    while(length > 0)
+    {
+        ssize_t written = ::write(fd, text, length);
+        if(written <= 0) return;
+        text += written;
+        length -= written;
+    }
+}
+
+static void writeHex(int fd, uintptr_t value)
+{
+    char buffer[2 + sizeof(uintptr_t) * 2 + 1];
+    const int digits = sizeof(uintptr_t) * 2;
+    buffer[0] = '0';
+    buffer[1] = 'x';
+    for(int index = digits - 1; index >= 0; index--)
+    {
+        buffer[2 + index] = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    }
+    buffer[2 + digits] = '\0';
+    writeText(fd, buffer);
+}
+
+static void writeNumber(int fd, long value)
+{
+    char buffer[24];
+    int pos = sizeof(buffer) - 1;
+    buffer[pos] = '\0';
+    const bool negative = value < 0;
+    unsigned long number = negative ? -(unsigned long)value : value;
+    do {
+        buffer[--pos] = '0' + number % 10;
+        number /= 10;
+    } while(number > 0);
+    if(negative)
+        buffer[--pos] = '-';
+    writeText(fd, buffer + pos);
+}
+
+static void writeRegister(int fd, const char* name, uintptr_t value)
+{
+    writeText(fd, name);
+    writeText(fd, " ");
+    writeHex(fd, value);
+    writeText(fd, "\n");
+}
+
+static uintptr_t writeRegisters(int fd, const ucontext_t* context)
+{
+    uintptr_t sp = 0;
+    writeText(fd, "\n=== Registers ===\n");
+#if defined(__x86_64__)
+    static const char* const names[] = {
+        "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15", "rdi", "rsi", "rbp",
+        "rbx", "rdx", "rax", "rcx", "rsp", "rip", "efl", "csgsfs", "err", "trapno", "oldmask", "cr2"
+    };
+    for(int index = 0; index < NGREG; index++)
+        writeRegister(fd, names[index], context->uc_mcontext.gregs[index]);
+    sp = context->uc_mcontext.gregs[REG_RSP];
+#elif defined(__i386__)
+    for(int index = 0; index < NGREG; index++)
+    {
+        writeText(fd, "gregs[");
+        writeNumber(fd, index);
+        writeRegister(fd, "]", context->uc_mcontext.gregs[index]);
+    }
+    sp = context->uc_mcontext.gregs[REG_ESP];
+#elif defined(__aarch64__)
+    for(int index = 0; index < 31; index++)
+    {
+        writeText(fd, "x");
+        writeNumber(fd, index);
+        writeRegister(fd, "", context->uc_mcontext.regs[index]);
+    }
+    writeRegister(fd, "sp", context->uc_mcontext.sp);
+    writeRegister(fd, "pc", context->uc_mcontext.pc);
+    writeRegister(fd, "pstate", context->uc_mcontext.pstate);
+    sp = context->uc_mcontext.sp;
+#elif defined(__arm__)
+    const unsigned long* regs = &context->uc_mcontext.arm_r0;
+    for(int index = 0; index < 11; index++)
+    {
+        writeText(fd, "r");
+        writeNumber(fd, index);
+        writeRegister(fd, "", regs[index]);
+    }
+    writeRegister(fd, "fp", context->uc_mcontext.arm_fp);
+    writeRegister(fd, "ip", context->uc_mcontext.arm_ip);
+    writeRegister(fd, "sp", context->uc_mcontext.arm_sp);
+    writeRegister(fd, "lr", context->uc_mcontext.arm_lr);
+    writeRegister(fd, "pc", context->uc_mcontext.arm_pc);
+    writeRegister(fd, "cpsr", context->uc_mcontext.arm_cpsr);
+    sp = context->uc_mcontext.arm_sp;
+#else
+    Q_UNUSED(context)
+    writeText(fd, "not supported on this architecture\n");
+#endif
+    return sp;
+}
+
+static void writeStack(int fd, uintptr_t sp)
+{
+    writeText(fd, "\n=== Stack ===\n");
+    if(sp == 0 || t_stack_high == 0 || sp < t_stack_low || sp >= t_stack_high)
+    {
+        // Reading past the end of unknown stack would crash the handler
+        writeText(fd, "stack bounds are unknown\n");
+        return;
+    }
+
+    const uintptr_t end = qMin<uintptr_t>(t_stack_high, sp + CRASH_STACK_DUMP_SIZE);
+    for(uintptr_t address = sp & ~(sizeof(uintptr_t) - 1); address + sizeof(uintptr_t) <= end; address += sizeof(uintptr_t))
+    {
+        writeHex(fd, address);
+        writeText(fd, " ");
+        writeHex(fd, *(const uintptr_t*) address);
+        writeText(fd, "\n");
+    }
+}
+
+static void copyFile(int fd, const char* path)
+{
+    int source = ::open(path, O_RDONLY);
+    if(source < 0) return;
+
+    char buffer[4096];
+    ssize_t length;
+    while((length = ::read(source, buffer, sizeof(buffer))) > 0)
+    {
+        if(::write(fd, buffer, length) != length)
+            break;
+    }
+    ::close(source);
+}
+
+static void writeRecords(int fd)
+{
+    writeText(fd, "\n=== Last log records ===\n");
+
+    // Oldest slot is the one that will be written next
+    const quint32 next = s_next_sequence.load(std::memory_order_acquire);
+    for(int index = 0; index < CRASH_RECORDER_SLOTS; index++)
+    {
+        const CrashRecorderSlot& slot = s_slots[(next + index) % CRASH_RECORDER_SLOTS];
+        if(slot.sequence.load(std::memory_order_acquire) == 0)
+            continue;
+
+        if(::write(fd, slot.text, slot.length) != slot.length)
+            break;
+        if(slot.length == 0 || slot.text[slot.length - 1] != '\n')
+            writeText(fd, "\n");
+    }
+}
+
+static void crashHandler(int signal, siginfo_t* info, void* context)
+{
+    // A crash inside the handler or in another thread at the same time
+    if(!s_crashed.exchange(true))
+    {
+        int fd = ::open(s_dump_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd >= 0)
+        {
+            writeText(fd, "=== Crash ===\nsignal ");
+            writeNumber(fd, signal);
+            writeText(fd, "\ncode ");
+            writeNumber(fd, info->si_code);
+            writeText(fd, "\naddress ");
+            writeHex(fd, (uintptr_t) info->si_addr);
+            writeText(fd, "\npid ");
+            writeNumber(fd, getpid());
+            writeText(fd, "\n");
+
+            uintptr_t sp = writeRegisters(fd, (const ucontext_t*) context);
+            writeStack(fd, sp);
+
+            writeText(fd, "\n=== Maps ===\n");
+            copyFile(fd, "/proc/self/maps");
+
+            writeRecords(fd);
+            ::close(fd);
+
+            writeText(STDERR_FILENO, "Crash dump has been written to ");
+            writeText(STDERR_FILENO, s_dump_file);
+            writeText(STDERR_FILENO, "\n");
+        }
+    }
+
+    // Let the previous handler (or the default action) finish the process
+    for(int index = 0; index < CRASH_SIGNAL_COUNT; index++)
+    {
+        if(CRASH_SIGNALS[index] == signal)
+            sigaction(signal, &s_previous_actions[index], NULL);
+    }
+
+    // Faults are raised again when the instruction is restarted, other signals are not
+    if(info->si_code <= 0 || signal == SIGABRT)
+        raise(signal);
+}
+
+#endif // CRASH_RECORDER_HANDLER
+
+/**
+ * @brief CrashRecorder::install
+ *
+ * Installs crash signal handlers in the calling (main) thread.
+ */
+void CrashRecorder::install(const QString &dump_file)
+{
+#ifdef CRASH_RECORDER_HANDLER
+    const QByteArray file_name = dump_file.toLocal8Bit();
+    strncpy(s_dump_file, file_name.constData(), sizeof(s_dump_file) - 1);
+
+    installThread();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = &crashHandler;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+
+    for(int index = 0; index < CRASH_SIGNAL_COUNT; index++)
+        sigaction(CRASH_SIGNALS[index], &action, &s_previous_actions[index]);
+#else
+    Q_UNUSED(dump_file)
+#endif // CRASH_RECORDER_HANDLER
+}
+
+/**
+ * @brief CrashRecorder::installThread
+ *
+ * Sets up the alternate signal stack and remembers stack bounds of the calling thread.
+ * The stack is freed when the thread exits. Repeated calls keep the installed stack.
+ */
+void CrashRecorder::installThread()
+{
+#ifdef CRASH_RECORDER_HANDLER
+    t_alt_stack.install();
+
+    pthread_attr_t attributes;
+    if(pthread_getattr_np(pthread_self(), &attributes) == 0)
+    {
+        void* address = NULL;
+        size_t size = 0;
+        if(pthread_attr_getstack(&attributes, &address, &size) == 0)
+        {
+            t_stack_low = (uintptr_t) address;
+            t_stack_high = (uintptr_t) address + size;
+        }
+        pthread_attr_destroy(&attributes);
+    }
+#endif // CRASH_RECORDER_HANDLER
+}
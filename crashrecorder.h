@@ -0,0 +1,31 @@
+#ifndef CRASHRECORDER_H
+#define CRASHRECORDER_H
+
+#include <QByteArray>
+#include <QString>
+
+namespace yasem {
+
+/**
+ * @brief Keeps the last log lines in memory and dumps them on crash.
+ *
+ * Lines are copied into a static ring of fixed-size slots, so the crash handler
+ * doesn't need to allocate anything. On SIGSEGV, SIGBUS, SIGILL, SIGFPE or SIGABRT
+ * the handler writes the signal info, registers, raw stack words, /proc/self/maps
+ * and the recorded lines into the dump file using only async-signal-safe calls.
+ * Addresses are symbolized later with the maps and debug symbols.
+ *
+ * The handler runs on an alternate stack, so it works after a stack overflow too.
+ * Threads other than the main one need installThread() for that.
+ */
+class CrashRecorder
+{
+public:
+    static void install(const QString &dump_file);
+    static void installThread();
+    static void record(const QByteArray &line);
+};
+
+}
+
+#endif // CRASHRECORDER_H
@@ -0,0 +1,827 @@
+#include "inifile.h"
+
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QRect>
+#include <QSize>
+#include <QPoint>
+
+#include <cstring>
+#include <algorithm>
+
+using namespace yasem;
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static inline bool isSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+static inline int hexValue(char ch)
+{
+    if(ch >= '0' && ch <= '9') return ch - '0';
+    if(ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if(ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+static void chopTrailingSpaces(QString &str)
+{
+    int size = str.size();
+    while(size > 0 && (str.at(size - 1) == QLatin1Char(' ') || str.at(size - 1) == QLatin1Char('\t')))
+        size--;
+    str.truncate(size);
+}
+
+/**
+ * Same as QSettingsPrivate::iniEscapedString() without a text codec.
+ */
+static void escapeString(const QString &str, QByteArray &result)
+{
+    const int start = result.size();
+    bool needs_quotes = false;
+    bool escape_next_if_digit = false;
+
+    for(const QChar& qch: str)
+    {
+        const uint ch = qch.unicode();
+        if(ch == ';' || ch == ',' || ch == '=')
+            needs_quotes = true;
+
+        if(escape_next_if_digit && hexValue(ch < 0x80 ? char(ch) : 0) >= 0)
+        {
+            result += "\\x" + QByteArray::number(ch, 16);
+            continue;
+        }
+
+        escape_next_if_digit = false;
+
+        switch(ch)
+        {
+            case '\0': result += "\\0"; escape_next_if_digit = true; break;
+            case '\a': result += "\\a"; break;
+            case '\b': result += "\\b"; break;
+            case '\f': result += "\\f"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            case '\v': result += "\\v"; break;
+            case '"':  result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            default:
+            {
+                if(ch <= 0x1F || ch >= 0x7F)
+                {
+                    result += "\\x" + QByteArray::number(ch, 16);
+                    escape_next_if_digit = true;
+                }
+                else
+                    result += char(ch);
+            }
+        }
+    }
+
+    if(needs_quotes || (start < result.size() && (result.at(start) == ' ' || result.at(result.size() - 1) == ' ')))
+    {
+        result.insert(start, '"');
+        result += '"';
+    }
+}
+
+/**
+ * Same as QSettingsPrivate::variantToString().
+ */
+static QString variantToString(const QVariant &value)
+{
+    switch(value.type())
+    {
+        case QVariant::Invalid:
+            return QStringLiteral("@Invalid()");
+        case QVariant::ByteArray:
+            return QStringLiteral("@ByteArray(") + QString::fromLatin1(value.toByteArray()) + QLatin1Char(')');
+        case QVariant::String:
+        case QVariant::LongLong:
+        case QVariant::ULongLong:
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::Bool:
+        case QVariant::Double:
+        {
+            QString result = value.toString();
+            if(result.startsWith(QLatin1Char('@')))
+                result.prepend(QLatin1Char('@'));
+            return result;
+        }
+        case QVariant::Rect:
+        {
+            QRect rect = value.toRect();
+            return QString("@Rect(%1 %2 %3 %4)").arg(rect.x()).arg(rect.y()).arg(rect.width()).arg(rect.height());
+        }
+        case QVariant::Size:
+        {
+            QSize size = value.toSize();
+            return QString("@Size(%1 %2)").arg(size.width()).arg(size.height());
+        }
+        case QVariant::Point:
+        {
+            QPoint point = value.toPoint();
+            return QString("@Point(%1 %2)").arg(point.x()).arg(point.y());
+        }
+        default:
+        {
+            QByteArray data;
+            QDataStream stream(&data, QIODevice::WriteOnly);
+            stream.setVersion(QDataStream::Qt_4_0);
+            stream << value;
+            return QStringLiteral("@Variant(") + QString::fromLatin1(data) + QLatin1Char(')');
+        }
+    }
+}
+
+/**
+ * Same as QSettingsPrivate::stringToVariant().
+ */
+static QVariant stringToVariant(const QString &str)
+{
+    if(!str.startsWith(QLatin1Char('@')))
+        return str;
+
+    if(str.startsWith(QLatin1String("@@")))
+        return str.mid(1);
+
+    if(str.endsWith(QLatin1Char(')')))
+    {
+        if(str.startsWith(QLatin1String("@ByteArray(")))
+            return str.mid(11, str.size() - 12).toLatin1();
+        if(str.startsWith(QLatin1String("@String(")))
+            return str.mid(8, str.size() - 9);
+        if(str == QLatin1String("@Invalid()"))
+            return QVariant();
+        if(str.startsWith(QLatin1String("@Variant(")))
+        {
+            QByteArray data = str.mid(9, str.size() - 10).toLatin1();
+            QDataStream stream(&data, QIODevice::ReadOnly);
+            stream.setVersion(QDataStream::Qt_4_0);
+            QVariant result;
+            stream >> result;
+            return result;
+        }
+
+        const int args_begin = str.indexOf(QLatin1Char('(')) + 1;
+        const QStringList args = str.mid(args_begin, str.size() - args_begin - 1).split(QLatin1Char(' '));
+        if(str.startsWith(QLatin1String("@Rect(")) && args.size() == 4)
+            return QRect(args.at(0).toInt(), args.at(1).toInt(), args.at(2).toInt(), args.at(3).toInt());
+        if(str.startsWith(QLatin1String("@Size(")) && args.size() == 2)
+            return QSize(args.at(0).toInt(), args.at(1).toInt());
+        if(str.startsWith(QLatin1String("@Point(")) && args.size() == 2)
+            return QPoint(args.at(0).toInt(), args.at(1).toInt());
+    }
+
+    return str;
+}
+
+IniFile::IniFile(const QString &file_name) :
+    m_file_name(file_name),
+    m_data(NULL),
+    m_size(0),
+    m_is_open(false),
+    m_file_size(-1)
+{
+
+}
+
+IniFile::~IniFile()
+{
+    close();
+}
+
+/**
+ * @brief IniFile::open
+ *
+ * Maps and parses the file. A missing file is opened as an empty one.
+ */
+bool IniFile::open()
+{
+    close();
+
+    QFileInfo info(m_file_name);
+    m_file_size = info.exists() ? info.size() : -1;
+    m_modified = info.lastModified();
+
+    if(info.exists())
+    {
+        m_file.setFileName(m_file_name);
+        if(!m_file.open(QFile::ReadOnly))
+            return false;
+
+        m_size = int(m_file.size());
+        if(m_size > 0)
+        {
+            m_data = reinterpret_cast<const char*>(m_file.map(0, m_size));
+            if(m_data == NULL)
+            {
+                // Some file systems don't support mapping
+                m_buffer = m_file.readAll();
+                m_data = m_buffer.constData();
+                m_size = m_buffer.size();
+                m_file.close();
+            }
+        }
+    }
+
+    parse();
+    m_is_open = true;
+    return true;
+}
+
+void IniFile::close()
+{
+    m_sections.clear();
+    m_section_index.clear();
+    m_file.close();
+    m_buffer.clear();
+    m_data = NULL;
+    m_size = 0;
+    m_is_open = false;
+}
+
+bool IniFile::isOpen() const
+{
+    return m_is_open;
+}
+
+/**
+ * @brief IniFile::isStale
+ *
+ * Returns true if the file has been changed on disk since it was opened.
+ */
+bool IniFile::isStale() const
+{
+    QFileInfo info(m_file_name);
+    if(!info.exists())
+        return m_file_size >= 0;
+    return info.size() != m_file_size || info.lastModified() != m_modified;
+}
+
+QString IniFile::fileName() const
+{
+    return m_file_name;
+}
+
+void IniFile::parse()
+{
+    Section* current = NULL;
+    int pos = 0;
+
+    while(pos < m_size)
+    {
+        int line_begin = pos;
+        const char* newline = static_cast<const char*>(memchr(m_data + pos, '\n', m_size - pos));
+        int line_end = newline != NULL ? int(newline - m_data) : m_size;
+
+        // Backslash before a line break continues the value on the next line
+        for(;;)
+        {
+            int last = line_end;
+            while(last > line_begin && m_data[last - 1] == '\r')
+                last--;
+            int slashes = 0;
+            while(last - slashes > line_begin && m_data[last - slashes - 1] == '\\')
+                slashes++;
+            if(slashes % 2 == 0 || line_end >= m_size)
+                break;
+            newline = static_cast<const char*>(memchr(m_data + line_end + 1, '\n', m_size - line_end - 1));
+            line_end = newline != NULL ? int(newline - m_data) : m_size;
+        }
+        pos = line_end + 1;
+
+        while(line_begin < line_end && isSpace(m_data[line_begin]))
+            line_begin++;
+        int trimmed_end = line_end;
+        while(trimmed_end > line_begin && isSpace(m_data[trimmed_end - 1]))
+            trimmed_end--;
+
+        if(line_begin == trimmed_end || m_data[line_begin] == ';')
+            continue;
+
+        const int next_line = qMin(pos, m_size);
+
+        if(m_data[line_begin] == '[')
+        {
+            const char* close = static_cast<const char*>(memchr(m_data + line_begin, ']', trimmed_end - line_begin));
+            const int name_end = close != NULL ? int(close - m_data) : trimmed_end;
+            const QByteArray name = QByteArray::fromRawData(m_data + line_begin + 1, name_end - line_begin - 1);
+
+            const QByteArray lower_name = name.toLower();
+            QString group;
+            if(lower_name == "general")
+                group = QString();
+            else if(lower_name == "%general")
+                group = QStringLiteral("General");
+            else
+                group = unescapeKey(name.constData(), name.size());
+
+            current = section(group);
+            if(current->body_end < 0 || current->entries.isEmpty())
+            {
+                current->name = name;
+                current->body_end = next_line;
+            }
+            continue;
+        }
+
+        if(current == NULL)
+        {
+            current = section(QString());
+            current->body_end = line_begin;
+        }
+
+        const char* equals = static_cast<const char*>(memchr(m_data + line_begin, '=', trimmed_end - line_begin));
+        if(equals == NULL)
+            continue;
+
+        int key_end = int(equals - m_data);
+        while(key_end > line_begin && isSpace(m_data[key_end - 1]))
+            key_end--;
+        int value_begin = int(equals - m_data) + 1;
+        while(value_begin < trimmed_end && isSpace(m_data[value_begin]))
+            value_begin++;
+
+        Entry entry;
+        entry.key = QByteArray::fromRawData(m_data + line_begin, key_end - line_begin);
+        entry.value_begin = value_begin;
+        entry.value_end = trimmed_end;
+        entry.changed = false;
+
+        // Later values override earlier ones like in QSettings
+        auto iterator = current->index.constFind(entry.key);
+        if(iterator != current->index.constEnd())
+            current->entries[iterator.value()] = entry;
+        else
+        {
+            current->index.insert(entry.key, current->entries.size());
+            current->entries.append(entry);
+        }
+        current->body_end = next_line;
+    }
+}
+
+IniFile::Section* IniFile::section(const QString &group)
+{
+    auto iterator = m_section_index.constFind(group);
+    if(iterator != m_section_index.constEnd())
+        return &m_sections[iterator.value()];
+
+    Section section;
+    section.group = group;
+    section.body_end = -1;
+    if(group.isEmpty())
+        section.name = "General";
+    else if(group.compare(QLatin1String("General"), Qt::CaseInsensitive) == 0)
+        section.name = "%General";
+    else
+        section.name = escapeKey(group);
+
+    m_section_index.insert(group, m_sections.size());
+    m_sections.append(section);
+    return &m_sections.last();
+}
+
+/**
+ * @brief IniFile::findEntry
+ *
+ * QSettings puts "a/b/c" into section "a" as "b\c", but the same key may be written by hand
+ * as "c" in section "a/b" or as "a\b\c" without a section, so all of them are checked.
+ */
+const IniFile::Entry* IniFile::findEntry(const QString &key) const
+{
+    int slash = key.indexOf(QLatin1Char('/'));
+    while(slash > 0)
+    {
+        auto section = m_section_index.constFind(key.left(slash));
+        if(section != m_section_index.constEnd())
+        {
+            const Section& data = m_sections.at(section.value());
+            auto entry = data.index.constFind(escapeKey(key.mid(slash + 1)));
+            if(entry != data.index.constEnd())
+                return &data.entries.at(entry.value());
+        }
+        slash = key.indexOf(QLatin1Char('/'), slash + 1);
+    }
+
+    auto section = m_section_index.constFind(QString());
+    if(section != m_section_index.constEnd())
+    {
+        const Section& data = m_sections.at(section.value());
+        auto entry = data.index.constFind(escapeKey(key));
+        if(entry != data.index.constEnd())
+            return &data.entries.at(entry.value());
+    }
+    return NULL;
+}
+
+IniFile::Entry* IniFile::findEntry(const QString &key)
+{
+    return const_cast<Entry*>(static_cast<const IniFile*>(this)->findEntry(key));
+}
+
+bool IniFile::contains(const QString &key) const
+{
+    return findEntry(key) != NULL;
+}
+
+QVariant IniFile::value(const QString &key, const QVariant &default_value) const
+{
+    const Entry* entry = findEntry(key);
+    if(entry == NULL)
+        return default_value;
+
+    if(entry->changed)
+        return unescapeValue(entry->value.constData(), entry->value.size());
+    return unescapeValue(m_data + entry->value_begin, entry->value_end - entry->value_begin);
+}
+
+/**
+ * @brief IniFile::keys
+ *
+ * Returns all keys in the group and its subgroups relative to the group
+ * like QSettings::allKeys() does.
+ */
+QStringList IniFile::keys(const QString &group) const
+{
+    QStringList result;
+    QString prefix = group;
+    if(!prefix.isEmpty() && !prefix.endsWith(QLatin1Char('/')))
+        prefix.append(QLatin1Char('/'));
+
+    for(const Section& section: m_sections)
+    {
+        QString section_prefix = section.group;
+        if(!section_prefix.isEmpty())
+            section_prefix.append(QLatin1Char('/'));
+
+        for(const Entry& entry: section.entries)
+        {
+            QString key = section_prefix + unescapeKey(entry.key.constData(), entry.key.size());
+            if(!key.startsWith(prefix))
+                continue;
+            key.remove(0, prefix.size());
+            if(!result.contains(key))
+                result.append(key);
+        }
+    }
+    return result;
+}
+
+void IniFile::setValue(const QString &key, const QVariant &value)
+{
+    Entry* entry = findEntry(key);
+    if(entry == NULL)
+    {
+        const int slash = key.indexOf(QLatin1Char('/'));
+        Section* data = section(slash > 0 ? key.left(slash) : QString());
+
+        Entry new_entry;
+        new_entry.key = escapeKey(slash > 0 ? key.mid(slash + 1) : key);
+        new_entry.value_begin = -1;
+        new_entry.value_end = -1;
+        new_entry.changed = false;
+
+        data->index.insert(new_entry.key, data->entries.size());
+        data->entries.append(new_entry);
+        entry = &data->entries.last();
+    }
+
+    entry->value = escapeValue(value);
+    entry->changed = true;
+}
+
+/**
+ * @brief IniFile::toByteArray
+ *
+ * Returns the original text with changed values replaced and new keys added.
+ */
+QByteArray IniFile::toByteArray() const
+{
+    struct Edit
+    {
+        int begin;
+        int end;
+        QByteArray text;
+        bool operator<(const Edit& other) const { return begin < other.begin; }
+    };
+
+    QVector<Edit> edits;
+    QByteArray new_sections;
+
+    for(const Section& section: m_sections)
+    {
+        QByteArray new_lines;
+        for(const Entry& entry: section.entries)
+        {
+            if(!entry.changed) continue;
+
+            if(entry.value_begin >= 0)
+                edits.append({ entry.value_begin, entry.value_end, entry.value });
+            else
+                new_lines.append(entry.key).append('=').append(entry.value).append('\n');
+        }
+
+        if(new_lines.isEmpty()) continue;
+
+        if(section.body_end >= 0)
+        {
+            if(section.body_end > 0 && m_data[section.body_end - 1] != '\n')
+                new_lines.prepend('\n');
+            edits.append({ section.body_end, section.body_end, new_lines });
+        }
+        else
+        {
+            if(m_size > 0 || !new_sections.isEmpty())
+                new_sections.append('\n');
+            new_sections.append('[').append(section.name).append("]\n").append(new_lines);
+        }
+    }
+
+    std::stable_sort(edits.begin(), edits.end());
+
+    QByteArray result;
+    result.reserve(m_size + new_sections.size() + 256);
+
+    int pos = 0;
+    for(const Edit& edit: edits)
+    {
+        result.append(m_data + pos, edit.begin - pos);
+        result.append(edit.text);
+        pos = edit.end;
+    }
+    result.append(m_data + pos, m_size - pos);
+
+    if(!new_sections.isEmpty())
+    {
+        if(!result.isEmpty() && !result.endsWith('\n'))
+            result.append('\n');
+        result.append(new_sections);
+    }
+    return result;
+}
+
+/**
+ * @brief IniFile::save
+ *
+ * Writes the file. Saving to the opened file reopens it, so references into
+ * the old content are not used after the file is replaced.
+ */
+bool IniFile::save(const QString &file_name)
+{
+    const QString target = file_name.isEmpty() ? m_file_name : file_name;
+
+    QSaveFile file(target);
+    if(!file.open(QFile::WriteOnly))
+        return false;
+
+    const QByteArray data = toByteArray();
+    if(file.write(data) != data.size() || !file.commit())
+        return false;
+
+    if(target == m_file_name)
+        return open();
+    return true;
+}
+
+/**
+ * Same as QSettingsPrivate::iniEscapedKey().
+ */
+QByteArray IniFile::escapeKey(const QString &key)
+{
+    QByteArray result;
+    result.reserve(key.size() + key.size() / 2);
+    for(const QChar& qch: key)
+    {
+        const uint ch = qch.unicode();
+        if(ch == '/')
+            result += '\\';
+        else if((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')
+                || ch == '_' || ch == '-' || ch == '.')
+            result += char(ch);
+        else if(ch <= 0xFF)
+        {
+            result += '%';
+            result += HEX_DIGITS[ch / 16];
+            result += HEX_DIGITS[ch % 16];
+        }
+        else
+        {
+            result += "%U";
+            QByteArray hex = QByteArray::number(ch, 16).toUpper();
+            result += QByteArray(4 - hex.size(), '0') + hex;
+        }
+    }
+    return result;
+}
+
+/**
+ * Same as QSettingsPrivate::iniUnescapedKey().
+ */
+QString IniFile::unescapeKey(const char *data, int size)
+{
+    QString result;
+    result.reserve(size);
+
+    int i = 0;
+    while(i < size)
+    {
+        const char ch = data[i];
+        if(ch == '\\')
+        {
+            result += QLatin1Char('/');
+            i++;
+            continue;
+        }
+
+        if(ch != '%' || i + 1 >= size)
+        {
+            result += QLatin1Char(ch);
+            i++;
+            continue;
+        }
+
+        int first = i + 1;
+        int digits = 2;
+        if(data[first] == 'U')
+        {
+            first++;
+            digits = 4;
+        }
+
+        uint value = 0;
+        int count = 0;
+        while(count < digits && first + count < size && hexValue(data[first + count]) >= 0)
+        {
+            value = value * 16 + hexValue(data[first + count]);
+            count++;
+        }
+
+        if(count == 0)
+        {
+            result += QLatin1Char('%');
+            i++;
+            continue;
+        }
+
+        result += QChar(value);
+        i = first + count;
+    }
+    return result;
+}
+
+QByteArray IniFile::escapeValue(const QVariant &value)
+{
+    QByteArray result;
+
+    if(value.type() == QVariant::StringList || value.type() == QVariant::List)
+    {
+        const QVariantList list = value.toList();
+        if(list.isEmpty())
+            return "@Invalid()";
+
+        for(int index = 0; index < list.size(); index++)
+        {
+            if(index > 0)
+                result += ", ";
+            escapeString(variantToString(list.at(index)), result);
+        }
+        return result;
+    }
+
+    escapeString(variantToString(value), result);
+    return result;
+}
+
+/**
+ * Same as QSettingsPrivate::iniUnescapedStringList() followed by stringToVariant().
+ */
+QVariant IniFile::unescapeValue(const char *data, int size)
+{
+    QString current;
+    QStringList list;
+    bool is_list = false;
+    bool in_quotes = false;
+    bool quoted = false;
+
+    int i = 0;
+    while(i < size && (data[i] == ' ' || data[i] == '\t'))
+        i++;
+
+    while(i < size)
+    {
+        char ch = data[i];
+        if(ch == '\\')
+        {
+            if(++i >= size) break;
+            ch = data[i++];
+            switch(ch)
+            {
+                case 'a': current += QLatin1Char('\a'); break;
+                case 'b': current += QLatin1Char('\b'); break;
+                case 'f': current += QLatin1Char('\f'); break;
+                case 'n': current += QLatin1Char('\n'); break;
+                case 'r': current += QLatin1Char('\r'); break;
+                case 't': current += QLatin1Char('\t'); break;
+                case 'v': current += QLatin1Char('\v'); break;
+                case '"':
+                case '?':
+                case '\'':
+                case '\\':
+                    current += QLatin1Char(ch);
+                    break;
+                case 'x':
+                {
+                    uint value = 0;
+                    while(i < size && hexValue(data[i]) >= 0)
+                        value = value * 16 + hexValue(data[i++]);
+                    current += QChar(value);
+                    break;
+                }
+                case '\n':
+                case '\r':
+                {
+                    // Line continuation
+                    if(i < size && (data[i] == '\n' || data[i] == '\r') && data[i] != ch)
+                        i++;
+                    while(i < size && (data[i] == ' ' || data[i] == '\t'))
+                        i++;
+                    break;
+                }
+                default:
+                {
+                    if(ch >= '0' && ch <= '7')
+                    {
+                        uint value = ch - '0';
+                        while(i < size && data[i] >= '0' && data[i] <= '7')
+                            value = value * 8 + (data[i++] - '0');
+                        current += QChar(value);
+                    }
+                    // Unknown escape sequences are skipped
+                }
+            }
+        }
+        else if(ch == '"')
+        {
+            i++;
+            quoted = true;
+            in_quotes = !in_quotes;
+        }
+        else if(!in_quotes && ch == ',')
+        {
+            if(!quoted)
+                chopTrailingSpaces(current);
+            list.append(current);
+            current.clear();
+            is_list = true;
+            quoted = false;
+            i++;
+            while(i < size && (data[i] == ' ' || data[i] == '\t'))
+                i++;
+        }
+        else if(!in_quotes && ch == ';')
+        {
+            break;
+        }
+        else
+        {
+            const int begin = i;
+            while(i < size && data[i] != '\\' && data[i] != '"'
+                  && (in_quotes || (data[i] != ',' && data[i] != ';')))
+                i++;
+            current += QLatin1String(data + begin, i - begin);
+        }
+    }
+
+    if(!quoted)
+        chopTrailingSpaces(current);
+
+    if(!is_list)
+        return stringToVariant(current);
+
+    list.append(current);
+
+    QVariantList variants;
+    bool strings_only = true;
+    for(const QString& item: list)
+    {
+        QVariant variant = stringToVariant(item);
+        strings_only = strings_only && variant.type() == QVariant::String;
+        variants.append(variant);
+    }
+
+    if(!strings_only)
+        return variants;
+
+    QStringList result;
+    for(const QVariant& variant: variants)
+        result.append(variant.toString());
+    return result;
+}
@@ -0,0 +1,92 @@
+#ifndef INIFILE_H
+#define INIFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVariant>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QDateTime>
+
+namespace yasem {
+
+/**
+ * @brief Reader and writer of INI files in QSettings::IniFormat.
+ *
+ * The file is mapped into memory and split into sections and keys by one pass.
+ * Keys and values are kept as references into the mapped data, values are unescaped
+ * only when they're requested. Saving keeps the original text and replaces only
+ * values that have been changed, new keys are added to the end of their sections.
+ *
+ * Keys are full QSettings keys ("group/key"). Escaping of keys, values and lists,
+ * "@ByteArray()", "@Variant()" and other special values are compatible with QSettings.
+ *
+ * Not thread safe.
+ */
+class IniFile
+{
+public:
+    explicit IniFile(const QString &file_name);
+    ~IniFile();
+
+    bool open();
+    void close();
+    bool isOpen() const;
+    bool isStale() const;
+    QString fileName() const;
+
+    bool contains(const QString &key) const;
+    QVariant value(const QString &key, const QVariant &default_value = QVariant()) const;
+    QStringList keys(const QString &group = QString()) const;
+    void setValue(const QString &key, const QVariant &value);
+
+    QByteArray toByteArray() const;
+    bool save(const QString &file_name = QString());
+
+    static QByteArray escapeKey(const QString &key);
+    static QString unescapeKey(const char *data, int size);
+    static QByteArray escapeValue(const QVariant &value);
+    static QVariant unescapeValue(const char *data, int size);
+
+protected:
+    struct Entry
+    {
+        QByteArray key;     // escaped, "\\" separates subkeys
+        int value_begin;    // -1 for new keys
+        int value_end;
+        QByteArray value;   // escaped new value
+        bool changed;
+    };
+
+    struct Section
+    {
+        QByteArray name;    // escaped
+        QString group;
+        int body_end;       // offset after the last key line, -1 for new sections
+        QVector<Entry> entries;
+        QHash<QByteArray, int> index;
+    };
+
+    void parse();
+    Section* section(const QString &group);
+    const Entry* findEntry(const QString &key) const;
+    Entry* findEntry(const QString &key);
+
+    QString m_file_name;
+    QFile m_file;
+    QByteArray m_buffer;
+    const char* m_data;
+    int m_size;
+    bool m_is_open;
+    qint64 m_file_size;
+    QDateTime m_modified;
+
+    QVector<Section> m_sections;
+    QHash<QString, int> m_section_index;
+};
+
+}
+
+#endif // INIFILE_H
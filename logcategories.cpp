@@ -0,0 +1,180 @@
+#include "logcategories.h"
+
+#include <QByteArray>
+
+using namespace yasem;
+
+static const char* const LOG_CATEGORY_PREFIX = "yasem.";
+
+#if QT_VERSION >= 0x050500
+static const QtMsgType LOG_LEVEL_INFO = QtInfoMsg;
+#else
+// There are no info messages before Qt 5.5, "info" level only disables debug messages
+static const QtMsgType LOG_LEVEL_INFO = QtWarningMsg;
+#endif
+
+Q_LOGGING_CATEGORY(yasemCore,       "yasem.core")
+Q_LOGGING_CATEGORY(yasemPlugins,    "yasem.plugins")
+Q_LOGGING_CATEGORY(yasemProfiles,   "yasem.profiles")
+Q_LOGGING_CATEGORY(yasemConfig,     "yasem.config")
+Q_LOGGING_CATEGORY(yasemNetwork,    "yasem.network")
+
+QMutex LogCategories::m_mutex;
+QMap<QString, QtMsgType> LogCategories::m_levels;
+QHash<QString, QLoggingCategory*> LogCategories::m_plugin_categories;
+QThreadStorage<LogCategories::ThreadContext> LogCategories::m_context;
+
+void LogCategories::init(const QStringList &arguments)
+{
+#ifdef QT_DEBUG
+    bool verbose = true;
+#else
+    bool verbose = arguments.contains("--verbose");
+#endif
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if(!verbose)
+            m_levels.insert("*", LOG_LEVEL_INFO);
+    }
+
+    for(const QString& arg: arguments)
+    {
+        if(!arg.startsWith("--log-level="))
+            continue;
+
+        for(const QString& entry: arg.mid(arg.indexOf('=') + 1).split(',', QString::SkipEmptyParts))
+        {
+            const int separator = entry.lastIndexOf(':');
+            const QString category = separator < 0 ? QString("*") : entry.left(separator);
+            if(!setLevel(category, entry.mid(separator + 1)))
+                qWarning() << qPrintable(QString("Incorrect log level %1!").arg(entry));
+        }
+    }
+
+    applyRules();
+}
+
+/**
+ * @brief LogCategories::setLevel
+ *
+ * Sets minimal level of messages that are printed for the category.
+ * Returns false if the level name is unknown.
+ */
+bool LogCategories::setLevel(const QString &category, const QString &level)
+{
+    static const QHash<QString, QtMsgType> levels = {
+        { "debug",      QtDebugMsg },
+        { "info",       LOG_LEVEL_INFO },
+        { "warning",    QtWarningMsg },
+        { "critical",   QtCriticalMsg },
+    };
+
+    auto iterator = levels.constFind(level.toLower());
+    if(iterator == levels.constEnd())
+        return false;
+
+    setLevel(category, iterator.value());
+    return true;
+}
+
+void LogCategories::setLevel(const QString &category, QtMsgType level)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        // A new level for all categories overrides previous levels of each one
+        if(category == "*")
+            m_levels.clear();
+        m_levels.insert(category, level);
+    }
+    applyRules();
+}
+
+/**
+ * @brief LogCategories::plugin
+ *
+ * Returns log category of the plugin. Categories are created on demand and live until exit.
+ */
+QLoggingCategory& LogCategories::plugin(const QString &id)
+{
+    QMutexLocker locker(&m_mutex);
+    QLoggingCategory* category = m_plugin_categories.value(id);
+    if(category == NULL)
+    {
+        // QLoggingCategory keeps the pointer to the name
+        const QByteArray name = QByteArray(LOG_CATEGORY_PREFIX).append("plugin.").append(id.toLatin1());
+        category = new QLoggingCategory(qstrdup(name.constData()));
+        m_plugin_categories.insert(id, category);
+    }
+    return *category;
+}
+
+/**
+ * @brief LogCategories::currentPlugin
+ *
+ * Returns category of the plugin the current thread works for or NULL.
+ */
+QLoggingCategory* LogCategories::currentPlugin()
+{
+    return m_context.hasLocalData() ? m_context.localData().plugin : NULL;
+}
+
+LogCategories::PluginScope::PluginScope(const QString &id):
+    m_previous(currentPlugin())
+{
+    m_context.localData().plugin = &plugin(id);
+}
+
+LogCategories::PluginScope::~PluginScope()
+{
+    m_context.localData().plugin = m_previous;
+}
+
+/**
+ * @brief LogCategories::applyRules
+ *
+ * Converts levels into QLoggingCategory filter rules. Rules are applied
+ * in order, so the rule for all categories goes first.
+ */
+void LogCategories::applyRules()
+{
+    static const QList<QPair<QtMsgType, QString>> types = {
+        { QtDebugMsg,       "debug" },
+#if QT_VERSION >= 0x050500
+        { QtInfoMsg,        "info" },
+#endif
+        { QtWarningMsg,     "warning" },
+        { QtCriticalMsg,    "critical" },
+    };
+
+    QStringList rules;
+    {
+        QMutexLocker locker(&m_mutex);
+        for(auto iterator = m_levels.constBegin(); iterator != m_levels.constEnd(); ++iterator)
+        {
+            const QString category = QString(LOG_CATEGORY_PREFIX).append(iterator.key());
+            for(const QPair<QtMsgType, QString>& type: types)
+            {
+                const bool enabled = severity(type.first) >= severity(iterator.value());
+                rules.append(QString("%1.%2=%3").arg(category).arg(type.second).arg(enabled ? "true" : "false"));
+            }
+        }
+    }
+
+    QLoggingCategory::setFilterRules(rules.join('\n'));
+}
+
+int LogCategories::severity(QtMsgType type)
+{
+    // QtInfoMsg has been added after other types, so enum values are not ordered
+    switch(type)
+    {
+        case QtDebugMsg:    return 0;
+#if QT_VERSION >= 0x050500
+        case QtInfoMsg:     return 1;
+#endif
+        case QtWarningMsg:  return 2;
+        case QtCriticalMsg: return 3;
+        default:            return 4;
+    }
+}
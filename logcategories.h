@@ -0,0 +1,81 @@
+#ifndef LOGCATEGORIES_H
+#define LOGCATEGORIES_H
+
+#include <QLoggingCategory>
+#include <QStringList>
+#include <QMap>
+#include <QHash>
+#include <QMutex>
+#include <QThreadStorage>
+
+Q_DECLARE_LOGGING_CATEGORY(yasemCore)
+Q_DECLARE_LOGGING_CATEGORY(yasemPlugins)
+Q_DECLARE_LOGGING_CATEGORY(yasemProfiles)
+Q_DECLARE_LOGGING_CATEGORY(yasemConfig)
+Q_DECLARE_LOGGING_CATEGORY(yasemNetwork)
+
+/*
+ * Unlike DEBUG(), these macros check the category level before the message
+ * is built, so disabled messages cost almost nothing.
+ */
+#define CORE_DEBUG()        qCDebug(yasemCore)
+#define PLUGINS_DEBUG()     qCDebug(yasemPlugins)
+#define PROFILES_DEBUG()    qCDebug(yasemProfiles)
+#define CONFIG_DEBUG()      qCDebug(yasemConfig)
+#define NETWORK_DEBUG()     qCDebug(yasemNetwork)
+#define PLUGIN_DEBUG(id)    qCDebug(yasem::LogCategories::plugin(id))
+
+namespace yasem {
+
+/**
+ * @brief Log levels of core categories and plugins.
+ *
+ * Categories are named core, plugins, profiles, config, network and plugin.<id>.
+ * Levels are set with --log-level=<level> or --log-level=<category>:<level>,...
+ * where level is one of debug, info, warning, critical. Debug messages are disabled
+ * by default in release builds unless --verbose is set.
+ *
+ * Plugins log with DEBUG() into the default category, so their messages are attributed
+ * to the plugin that is running in the thread (@see PluginScope) and filtered by
+ * the plugin's level in LoggerCore::MessageHandler().
+ */
+class LogCategories
+{
+public:
+    static void init(const QStringList &arguments);
+    static bool setLevel(const QString &category, const QString &level);
+    static void setLevel(const QString &category, QtMsgType level);
+    static QLoggingCategory& plugin(const QString &id);
+    static QLoggingCategory* currentPlugin();
+
+    /**
+     * @brief Marks the code that runs on behalf of a plugin in the current thread.
+     */
+    class PluginScope
+    {
+    public:
+        explicit PluginScope(const QString &id);
+        ~PluginScope();
+    protected:
+        QLoggingCategory* m_previous;
+    };
+
+protected:
+    struct ThreadContext
+    {
+        ThreadContext(): plugin(NULL) {}
+        QLoggingCategory* plugin;
+    };
+
+    static void applyRules();
+    static int severity(QtMsgType type);
+
+    static QMutex m_mutex;
+    static QMap<QString, QtMsgType> m_levels;
+    static QHash<QString, QLoggingCategory*> m_plugin_categories;
+    static QThreadStorage<ThreadContext> m_context;
+};
+
+}
+
+#endif // LOGCATEGORIES_H
@@ -0,0 +1,88 @@
+#ifndef LOGFORMAT_H
+#define LOGFORMAT_H
+
+/*
+ * Log message types and binary log layout.
+ * Shared between the core and the log decoder (tools/logdecoder).
+ */
+
+#include <QtGlobal>
+
+#define LOG_TYPE_DEBUG QtDebugMsg
+#define LOG_TYPE_WARN QtWarningMsg
+#define LOG_TYPE_CRITICAL QtCriticalMsg
+#define LOG_TYPE_FATAL QtFatalMsg
+
+#define LOG_TYPE_STUB 1000
+#define LOG_TYPE_LOG 1001
+#define LOG_TYPE_INFO 1002
+
+#define LOG_TYPE_WTF 1010
+#define LOG_TYPE_FIXME 1011
+#define LOG_TYPE_BUG 1015
+
+namespace yasem {
+
+/**
+ * @brief Returns level label of the message type as it's printed in text log.
+ */
+inline const char* logTypeLabel(int type)
+{
+    switch(type)
+    {
+        case LOG_TYPE_DEBUG:    return "[DEBUG]";
+        case LOG_TYPE_INFO:     return "[INFO ]";
+        case LOG_TYPE_WARN:     return "[WARN ]";
+        case LOG_TYPE_CRITICAL: return "[CRIT ]";
+        case LOG_TYPE_FATAL:    return "[FATAL]";
+        case LOG_TYPE_STUB:     return "[STUB ]";
+        case LOG_TYPE_LOG:      return "[LOG  ]";
+        case LOG_TYPE_FIXME:    return "[FIXME]";
+        case LOG_TYPE_BUG:      return "[BUG  ]";
+        case LOG_TYPE_WTF:      return "[WTF  ]";
+        default:                return "[OTHER]";
+    }
+}
+
+/*
+ * Binary log file is a header followed by a ring of fixed-size records.
+ * Record with sequence number N is stored in slot (N - 1) % capacity.
+ * Sequence number of a slot is written last, so a record that has been
+ * interrupted by a crash has zero sequence and is skipped by the decoder.
+ * Values are in host byte order.
+ */
+static const quint32 LOG_BINARY_MAGIC = 0x474f4c59; // "YLOG"
+static const quint16 LOG_BINARY_VERSION = 1;
+static const int LOG_BINARY_RECORD_SIZE = 256;
+static const int LOG_BINARY_CATEGORY_SIZE = 24;
+static const int LOG_BINARY_MESSAGE_SIZE = LOG_BINARY_RECORD_SIZE - 32 - LOG_BINARY_CATEGORY_SIZE;
+
+struct LogBinaryHeader
+{
+    quint32 magic;
+    quint16 version;
+    quint16 record_size;
+    quint32 capacity;               // Number of record slots
+    quint32 reserved_1;
+    quint64 next_sequence;          // Sequence number of the next record, starts from 1
+    quint8 reserved_2[40];
+};
+
+struct LogBinaryRecord
+{
+    quint64 sequence;               // 0 if the slot is empty
+    qint64 timestamp;               // ms since epoch
+    quint64 thread_id;
+    quint16 type;                   // LOG_TYPE_*
+    quint16 length;                 // Message length in bytes
+    quint32 reserved;
+    char category[LOG_BINARY_CATEGORY_SIZE];
+    char message[LOG_BINARY_MESSAGE_SIZE];   // UTF-8, not null-terminated, truncated to fit
+};
+
+Q_STATIC_ASSERT(sizeof(LogBinaryHeader) == 64);
+Q_STATIC_ASSERT(sizeof(LogBinaryRecord) == LOG_BINARY_RECORD_SIZE);
+
+}
+
+#endif // LOGFORMAT_H
@@ -1,24 +1,26 @@
 #include "core.h"
 #include "loggercore.h"
+#include "logringbuffer.h"
+#include "logwriterthread.h"
+#include "logformat.h"
+#include "binarylogsink.h"
+#include "rotatinglogfile.h"
+#include "crashrecorder.h"
+#include "logcategories.h"
+#include "stacktrace.h"
 
 #include <cstdio>
 #include <QDateTime>
 #include <QFile>
 #include <QDir>
 #include <QFileInfo>
+#include <QThread>
 
-#define LOG_TYPE_DEBUG QtDebugMsg
-#define LOG_TYPE_WARN QtWarningMsg
-#define LOG_TYPE_CRITICAL QtCriticalMsg
-#define LOG_TYPE_FATAL QtFatalMsg
-
-#define LOG_TYPE_STUB 1000
-#define LOG_TYPE_LOG 1001
-#define LOG_TYPE_INFO 1002
-
-#define LOG_TYPE_WTF 1010
-#define LOG_TYPE_FIXME 1011
-#define LOG_TYPE_BUG 1015
+#ifdef Q_OS_UNIX
+#include <sys/uio.h>
+#include <limits.h>
+#include <errno.h>
+#endif //Q_OS_UNIX
 
 static const char* LOG_PREFIX_STUB = "$STUB$";
 static const char* LOG_PREFIX_LOG = "$LOG$";
@@ -26,11 +28,20 @@ static const char* LOG_PREFIX_INFO = "$INFO$";
 static const char* LOG_PREFIX_WTF = "$WTF$";
 static const char* LOG_PREFIX_FIXME = "$FIXME$";
 
-static const QString TIME_FORMAT = "hh:mm:ss:zzz";
+static const size_t LOG_QUEUE_SIZE = 8192;
+static const qint64 LOG_BINARY_DEFAULT_SIZE = 1024; // KB
+static const qint64 LOG_DEFAULT_MAX_SIZE = 10240; // KB
+static const qint64 LOG_DEFAULT_MAX_AGE = 0; // hours
+static const int LOG_DEFAULT_KEEP = 5;
 
 using namespace yasem;
 
-QFile* LoggerCore::m_log_file = NULL;
+RotatingLogFile* LoggerCore::m_log_file = NULL;
+BinaryLogSink* LoggerCore::m_binary_sink = NULL;
+LogRingBuffer* LoggerCore::m_queue = NULL;
+QAtomicPointer<LogWriterThread> LoggerCore::m_writer;
+// Recursive, because messages of the writer thread itself are written synchronously
+QMutex LoggerCore::m_write_mutex(QMutex::Recursive);
 
 LoggerCore::LoggerCore(QObject *parent) :
     QObject(parent)
@@ -42,6 +53,13 @@ LoggerCore::~LoggerCore()
 {
 }
 
+/**
+ * @brief LoggerCore::MessageHandler
+ *
+ * Only makes a log record in the calling thread. Formatting and output are done
+ * by the log writer thread. Critical and fatal messages are written immediately
+ * after everything that's already in the queue.
+ */
 void LoggerCore::MessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
 {
     #ifdef QT_DEBUG
@@ -50,170 +68,341 @@ void LoggerCore::MessageHandler(QtMsgType type, const QMessageLogContext &contex
         static bool verboseOutput = qApp->arguments().contains("--verbose");
     #endif
 
-    /**
-     * @brief localMsg
-     *
-        %{appname}	QCoreApplication::applicationName()
-        %{file}	Path to source file
-        %{function}	Function
-        %{line}	Line in source file
-        %{message}	The actual message
-        %{pid}	QCoreApplication::applicationPid()
-        %{threadid}	ID of current thread
-        %{type}	"debug", "warning", "critical" or "fatal"
-     */
-    QByteArray localMsg = msg.toLocal8Bit();
-
-    int msgType = (int) type;
-
-    if(localMsg.startsWith(LOG_PREFIX_STUB))
+    int record_type = (int) type;
+    int prefix_size = 0;
+    if(msg.startsWith(QLatin1String(LOG_PREFIX_STUB)))
     {
-        msgType = LOG_TYPE_STUB;
-        localMsg = localMsg.right(localMsg.length() - strlen(LOG_PREFIX_STUB));
+        record_type = LOG_TYPE_STUB;
+        prefix_size = strlen(LOG_PREFIX_STUB);
     }
-    else if(localMsg.startsWith(LOG_PREFIX_LOG))
+    else if(msg.startsWith(QLatin1String(LOG_PREFIX_LOG)))
     {
-        msgType = LOG_TYPE_LOG;
-        localMsg = localMsg.right(localMsg.length() - strlen(LOG_PREFIX_LOG));
+        record_type = LOG_TYPE_LOG;
+        prefix_size = strlen(LOG_PREFIX_LOG);
     }
-    else if(localMsg.startsWith(LOG_PREFIX_INFO))
+    else if(msg.startsWith(QLatin1String(LOG_PREFIX_INFO)))
     {
-        msgType = LOG_TYPE_INFO;
-        localMsg = localMsg.right(localMsg.length() - strlen(LOG_PREFIX_INFO));
+        record_type = LOG_TYPE_INFO;
+        prefix_size = strlen(LOG_PREFIX_INFO);
     }
-    else if(localMsg.startsWith(LOG_PREFIX_WTF))
+    else if(msg.startsWith(QLatin1String(LOG_PREFIX_WTF)))
     {
-        msgType = LOG_TYPE_WTF;
-        localMsg = localMsg.right(localMsg.length() - strlen(LOG_PREFIX_WTF));
+        record_type = LOG_TYPE_WTF;
+        prefix_size = strlen(LOG_PREFIX_WTF);
     }
-    else if(localMsg.startsWith(LOG_PREFIX_FIXME))
+    else if(msg.startsWith(QLatin1String(LOG_PREFIX_FIXME)))
+    {
+        record_type = LOG_TYPE_FIXME;
+        prefix_size = strlen(LOG_PREFIX_FIXME);
+    }
+
+    // Messages of other categories have been filtered by their levels (@see LogCategories).
+    // Debug messages of the default category are filtered before they're converted.
+    const char* category = context.category;
+    if(record_type == LOG_TYPE_DEBUG && (category == NULL || strcmp(category, "default") == 0))
     {
-        msgType = LOG_TYPE_FIXME;
-        localMsg = localMsg.right(localMsg.length() - strlen(LOG_PREFIX_FIXME));
+        // Plugins use the default category, the message belongs to the plugin running in this thread
+        QLoggingCategory* plugin = LogCategories::currentPlugin();
+        if(plugin != NULL)
+        {
+            if(!plugin->isDebugEnabled())
+                return;
+            category = plugin->categoryName();
+        }
+        else if(!verboseOutput)
+            return;
     }
 
-    QString message = localMsg;
+    LogRecord record;
+    record.type = record_type;
+    record.message = msg.midRef(prefix_size).toUtf8();
 
-    QString line = "";
+    record.timestamp = QDateTime::currentMSecsSinceEpoch();
+    record.thread_id = (quintptr) QThread::currentThreadId();
+    record.line = context.line;
+    if(category != NULL)
+        qstrncpy(record.category, category, LOG_BINARY_CATEGORY_SIZE);
 
+    switch(record.type)
+    {
+        case LOG_TYPE_DEBUG:
+        case LOG_TYPE_INFO:
+        case LOG_TYPE_WARN:
+        case LOG_TYPE_CRITICAL:
+        case LOG_TYPE_FATAL:
+        case LOG_TYPE_LOG:
+        {
 #ifdef EXTRA_DEBUG_INFO
-    if(context.file != NULL)
-        line = QString("(%1:%2) ").arg(context.file).arg(QString::number(context.line));
+            record.file = context.file;
 #endif
+            break;
+        }
+        default:
+        {
+            // The strings may belong to a plugin that is unloaded before the record is written
+            record.file = context.file;
+            record.function = context.function;
+            break;
+        }
+    }
 
-    QDateTime time = QDateTime::currentDateTime();
-    QString current_time;
-
-    if(time.isValid())
+    if(record.type == LOG_TYPE_CRITICAL || record.type == LOG_TYPE_FATAL)
     {
-        try {
-            current_time = time.toString(TIME_FORMAT);
-            //Sometimes it throws exception if the app is going to close
-        }catch(...)
+        flush();
+        writeRecords(QVector<LogRecord>() << record);
+
+        // Symbols are cached, so repeated errors from the same place are cheap
+        const std::string trace = Backtrace();
+        if(!trace.empty())
+            fputs(trace.c_str(), stderr);
+        else
+            SDK::Core::printCallStack();
+        fflush(stdout);
+        fflush(stderr);
+
+        if(record.type == LOG_TYPE_FATAL)
         {
-            current_time = "";
+            stopWriter();
+            abort();
         }
+        return;
     }
+
+    LogWriterThread* writer = m_writer.loadAcquire();
+    // Messages from the writer itself would wait for themselves if the queue is full
+    if(writer == NULL || QThread::currentThread() == writer)
+        writeRecords(QVector<LogRecord>() << record);
     else
+        writer->enqueue(record);
+}
+
+/**
+ * @brief LoggerCore::startWriter
+ *
+ * Starts the log writer thread. Until it's started messages are written synchronously.
+ */
+void LoggerCore::startWriter()
+{
+    if(m_writer.loadAcquire() != NULL) return;
+
+    m_queue = new LogRingBuffer(LOG_QUEUE_SIZE);
+    LogWriterThread* writer = new LogWriterThread(m_queue, &LoggerCore::writeRecords);
+    writer->start();
+    m_writer.storeRelease(writer);
+}
+
+/**
+ * @brief LoggerCore::stopWriter
+ *
+ * Writes all queued messages and stops the writer thread.
+ * Messages after that are written synchronously.
+ */
+void LoggerCore::stopWriter()
+{
+    LogWriterThread* writer = m_writer.loadAcquire();
+    if(writer == NULL) return;
+
+    m_writer.storeRelease(NULL);
+    writer->stop();
+    delete writer;
+
+    // Records that have been pushed while the writer was stopping
+    QVector<LogRecord> records;
+    LogRecord record;
+    while(m_queue->pop(record))
+        records.append(std::move(record));
+    if(!records.isEmpty())
+        writeRecords(records);
+}
+
+void LoggerCore::flush()
+{
+    LogWriterThread* writer = m_writer.loadAcquire();
+    if(writer != NULL && QThread::currentThread() != writer)
+        writer->flush();
+}
+
+/**
+ * @brief LoggerCore::formatRecord
+ *
+ * Appends formatted line to output. Returns output channel or NULL if the record shouldn't be printed.
+ */
+FILE* LoggerCore::formatRecord(const LogRecord &record, QByteArray &output, LogTimeCache &time_cache)
+{
+    const qint64 second = record.timestamp / 1000;
+    if(second != time_cache.second)
     {
-        current_time = "";
+        time_cache.second = second;
+        time_cache.text = QDateTime::fromMSecsSinceEpoch(second * 1000).toString("hh:mm:ss:").toLatin1();
     }
 
+    QByteArray current_time = time_cache.text;
+    current_time.append(QByteArray::number(record.timestamp % 1000).rightJustified(3, '0'));
+
+    QByteArray line;
+#ifdef EXTRA_DEBUG_INFO
+    if(!record.file.isNull())
+        line.append('(').append(record.file).append(':').append(QByteArray::number(record.line)).append(") ");
+#endif
+
     FILE* output_channel = stdout;
-    QString output_line;
 
-    switch (msgType) {
+    switch (record.type) {
         case LOG_TYPE_DEBUG:
-        {
-            if(verboseOutput)
-            {
-                output_line = QString("[DEBUG][%1] %2%3\n").arg(current_time).arg(line).arg(message);
-            }
-            break;
-        }
         case LOG_TYPE_INFO:
-        {
-            output_line = QString("[INFO ][%1] %2%3\n").arg(current_time).arg(line).arg(message);
-            break;
-        }
         case LOG_TYPE_WARN:
-        {
-            output_line = QString("[WARN ][%1] %2%3\n").arg(current_time).arg(line).arg(message);
+        case LOG_TYPE_LOG:
             break;
-        }
         case LOG_TYPE_CRITICAL:
-        {
-            output_channel = stderr;
-            output_line = QString("[CRIT ][%1] %2%3\n").arg(current_time).arg(line).arg(message);
-            fprintf(output_channel, "%s", output_line.toUtf8().constData());
-
-            SDK::Core::printCallStack();
-            break;
-        }
         case LOG_TYPE_FATAL:
         {
             output_channel = stderr;
-            output_line = QString("[FATAL][%1] %2%3\n").arg(current_time).arg(line).arg(message);
-            fprintf(output_channel, "%s", output_line.toUtf8().constData());
-
-            SDK::Core::printCallStack();
-            abort();
-        }
-        case LOG_TYPE_STUB:
-        {
-            if(context.function != NULL || !(message == NULL || message.length() == 0))
-            {
-                output_line = QString("[STUB ][%1] %2%3%4%5\n").arg(current_time).arg(line).arg(context.function).arg(message.length() > 0 ? ": " : "", message);
-            }
             break;
         }
-        case LOG_TYPE_LOG:
+        case LOG_TYPE_STUB:
         {
-            output_line = QString("[LOG  ][%1] %2%3\n").arg(current_time).arg(line).arg(message);
-            break;
+            if(record.function.isNull() && record.message.isEmpty())
+                return NULL;
+
+            output.append("[STUB ][").append(current_time).append("] ").append(line).append(record.function);
+            if(!record.message.isEmpty())
+                output.append(": ").append(record.message);
+            output.append('\n');
+            return output_channel;
         }
         case LOG_TYPE_FIXME:
         {
-            output_line = QString("[FIXME][%1] (%2:%3): %4\n").arg(current_time).arg(context.function).arg(QString::number(context.line)).arg(message);
-            break;
+            output.append("[FIXME][").append(current_time).append("] (").append(record.function).append(':')
+                    .append(QByteArray::number(record.line)).append("): ").append(record.message).append('\n');
+            return output_channel;
         }
         case LOG_TYPE_BUG:
-        {
-            output_channel = stderr;
-            output_line = QString("[BUG  ][%1] (%2:%3) %4 -> %5\n").arg(current_time).arg(context.file).arg(context.line).arg(context.function).arg(message);
-            break;
-        }
         case LOG_TYPE_WTF:
         {
-            output_channel = stderr;
-            output_line = QString("[WTF  ][%1] (%2:%3) %4 -> %5\n").arg(current_time).arg(context.file).arg(QString::number(context.line)).arg(context.function).arg(message);
-            break;
+            output.append(record.type == LOG_TYPE_BUG ? "[BUG  ][" : "[WTF  ][").append(current_time).append("] (")
+                    .append(record.file).append(':').append(QByteArray::number(record.line)).append(") ")
+                    .append(record.function).append(" -> ").append(record.message).append('\n');
+            return stderr;
         }
         default:
         {
-            output_line = QString( "[OTHER][%1] (%2:%3 | %4): %5\n").arg(current_time).arg(context.file).arg(QString::number(context.line)).arg(context.function).arg(message);
+            output.append("[OTHER][").append(current_time).append("] (").append(record.file).append(':')
+                    .append(QByteArray::number(record.line)).append(" | ").append(record.function).append("): ")
+                    .append(record.message).append('\n');
+            return output_channel;
         }
+    }
+
+    output.append(logTypeLabel(record.type)).append('[').append(current_time).append("] ").append(line).append(record.message).append('\n');
+    return output_channel;
+}
 
+/**
+ * @brief LoggerCore::writeRecords
+ *
+ * Formats a batch of records and writes it to stdout/stderr and the log file
+ * with one call per output. Critical messages are written by their threads
+ * while the writer thread is running, so batches are serialized.
+ */
+void LoggerCore::writeRecords(const QVector<LogRecord> &records)
+{
+    QMutexLocker locker(&m_write_mutex);
+    if(m_binary_sink != NULL)
+    {
+        for(const LogRecord& record: records)
+            m_binary_sink->write(record);
     }
 
-#ifdef QT_DEBUG
-    static bool colorOutput = false;
-#else
-    static bool colorOutput = qApp->arguments().contains("--color");
-#endif
+    LogTimeCache time_cache;
+    QVector<QByteArray> lines(records.size());
+    QVector<FILE*> channels(records.size());
 
-    if(colorOutput)
+    for(int index = 0; index < records.size(); index++)
     {
-        // Sometimes crashes the app on exit
-        //output_line = colorize(output_line);
+        channels[index] = formatRecord(records.at(index), lines[index], time_cache);
+        if(channels.at(index) != NULL)
+            CrashRecorder::record(lines.at(index));
     }
 
-    fprintf(output_channel, "%s", output_line.toUtf8().constData());
-    if(LoggerCore::m_log_file != NULL && LoggerCore::m_log_file->isOpen() && m_log_file->isWritable())
-        LoggerCore::m_log_file->write(output_line.toUtf8());
+    writeLines(stdout, lines, channels);
+    writeLines(stderr, lines, channels);
+    if(LoggerCore::m_log_file != NULL && LoggerCore::m_log_file->isOpen())
+    {
+        QMutexLocker locker(m_log_file->mutex());
+        m_log_file->written(writeLines(NULL, lines, channels));
+    }
+}
+
+/**
+ * @brief LoggerCore::writeLines
+ *
+ * Writes lines of the channel. NULL channel means the log file, it gets all lines.
+ * Returns number of bytes written.
+ */
+qint64 LoggerCore::writeLines(FILE* channel, const QVector<QByteArray> &lines, const QVector<FILE*> &channels)
+{
+#ifdef Q_OS_UNIX
+    const int fd = channel != NULL ? fileno(channel) : m_log_file->handle();
+
+    QVector<struct iovec> buffers;
+    buffers.reserve(lines.size());
+    for(int index = 0; index < lines.size(); index++)
+    {
+        if(channels.at(index) == NULL || (channel != NULL && channels.at(index) != channel))
+            continue;
 
-    fflush(stdout);
-    fflush(stderr);
+        struct iovec buffer;
+        buffer.iov_base = (void*) lines.at(index).constData();
+        buffer.iov_len = lines.at(index).size();
+        buffers.append(buffer);
+    }
+
+    qint64 total = 0;
+    struct iovec* next = buffers.data();
+    int count = buffers.size();
+    while(count > 0)
+    {
+        ssize_t written = ::writev(fd, next, qMin(count, IOV_MAX));
+        if(written < 0)
+        {
+            if(errno == EINTR) continue;
+            return total;
+        }
+        total += written;
+
+        // Skip buffers that have been written completely and move into a partially written one
+        while(count > 0 && (size_t)written >= next->iov_len)
+        {
+            written -= next->iov_len;
+            next++;
+            count--;
+        }
+        if(count > 0)
+        {
+            next->iov_base = (char*) next->iov_base + written;
+            next->iov_len -= written;
+        }
+    }
+    return total;
+#else
+    QByteArray data;
+    for(int index = 0; index < lines.size(); index++)
+    {
+        if(channels.at(index) == NULL || (channel != NULL && channels.at(index) != channel))
+            continue;
+        data.append(lines.at(index));
+    }
+
+    if(data.isEmpty()) return 0;
+
+    if(channel != NULL)
+    {
+        fwrite(data.constData(), 1, data.size(), channel);
+        fflush(channel);
+        return data.size();
+    }
+    return m_log_file->file()->write(data);
+#endif //Q_OS_UNIX
 }
 
 QString LoggerCore::colorize(const QString &str)
@@ -266,39 +455,122 @@ QString LoggerCore::colorize(const QString &str)
     return str;
 }
 
+/**
+ * @brief LoggerCore::initLogFile
+ *
+ * Opens text log set with --log=<file name>. The file is rotated when it's larger
+ * than --log-max-size KB or older than --log-max-age hours. Only --log-keep
+ * compressed segments are kept (@see RotatingLogFile).
+ */
 void LoggerCore::initLogFile(QObject* parent)
 {
+    Q_UNUSED(parent)
+
+    QString file_name;
+    qint64 max_size = LOG_DEFAULT_MAX_SIZE;
+    qint64 max_age = LOG_DEFAULT_MAX_AGE;
+    qint64 keep = LOG_DEFAULT_KEEP;
+
     for(const QString& arg: qApp->arguments())
     {
-        if(arg.startsWith("--log"))
+        qint64* value = NULL;
+        if(arg.startsWith("--log="))
         {
             QStringList data = arg.split('=');
             if(data.length() != 2)
-            {
                 qWarning() << qPrintable(QString("Incorrect argument %1!").arg(arg));
-            }
             else
+                file_name = data.at(1);
+        }
+        else if(arg.startsWith("--log-max-size="))
+            value = &max_size;
+        else if(arg.startsWith("--log-max-age="))
+            value = &max_age;
+        else if(arg.startsWith("--log-keep="))
+            value = &keep;
+
+        if(value != NULL)
+        {
+            bool ok = false;
+            const qint64 number = arg.mid(arg.indexOf('=') + 1).toLongLong(&ok);
+            if(ok && number >= 0)
+                *value = number;
+            else
+                qWarning() << qPrintable(QString("Incorrect argument %1!").arg(arg));
+        }
+    }
+
+    if(file_name.isEmpty()) return;
+
+    qDebug() << "Trying to open log file " << file_name;
+    QDir dir = QFileInfo(file_name).absoluteDir();
+    if(!dir.exists())
+    {
+        bool ok = dir.mkdir(dir.absolutePath());
+        if(!ok)
+        {
+            qWarning() << qPrintable(QString("Cannot create a directory %1 to write logs!").arg(dir.absolutePath()));
+            return;
+        }
+    }
+
+    RotatingLogFile* log_file = new RotatingLogFile(file_name, max_size * 1024, max_age * 3600, keep);
+    if(!log_file->open())
+    {
+        qWarning() << qPrintable(QString("Cannot open a log file %1!").arg(file_name));
+        delete log_file;
+        return;
+    }
+
+    // Called before the writer thread is started, so there are no concurrent writes
+    m_log_file = log_file;
+}
+
+/**
+ * @brief LoggerCore::initBinaryLog
+ *
+ * Opens binary ring log set with --log-binary=<file name>.
+ * Its size in KB is set with --log-binary-size.
+ */
+void LoggerCore::initBinaryLog()
+{
+    const QStringList arguments = qApp->arguments();
+    QString file_name;
+    qint64 size = LOG_BINARY_DEFAULT_SIZE;
+
+    for(const QString& arg: arguments)
+    {
+        if(arg.startsWith("--log-binary="))
+            file_name = arg.mid(arg.indexOf('=') + 1);
+        else if(arg.startsWith("--log-binary-size="))
+        {
+            bool ok = false;
+            size = arg.mid(arg.indexOf('=') + 1).toLongLong(&ok);
+            if(!ok || size <= 0)
             {
-                qDebug() << "Trying to open log file " << data.at(1);
-                LoggerCore::m_log_file = new QFile(parent);
-                LoggerCore::m_log_file->setFileName(data.at(1));
-                QFileInfo f_info(*LoggerCore::m_log_file);
-                QDir dir = f_info.absoluteDir();
-                if(!dir.exists())
-                {
-                    bool ok = dir.mkdir(dir.absolutePath());
-                    if(!ok)
-                    {
-                        qWarning() << qPrintable(QString("Cannot create a directory %1 to write logs!").arg(dir.absolutePath()));
-                        return;
-                    }
-                }
-                if(!LoggerCore::m_log_file->open(QFile::ReadWrite | QIODevice::Text))
-                {
-                    qWarning() << qPrintable(QString("Cannot open a log file %1!").arg(LoggerCore::m_log_file->fileName()));
-                }
+                qWarning() << qPrintable(QString("Incorrect argument %1!").arg(arg));
+                size = LOG_BINARY_DEFAULT_SIZE;
             }
-            break;
         }
     }
+
+    if(file_name.isEmpty()) return;
+
+    QDir dir = QFileInfo(file_name).absoluteDir();
+    if(!dir.exists() && !dir.mkpath(dir.absolutePath()))
+    {
+        qWarning() << qPrintable(QString("Cannot create a directory %1 to write logs!").arg(dir.absolutePath()));
+        return;
+    }
+
+    BinaryLogSink* sink = new BinaryLogSink();
+    if(!sink->open(file_name, size * 1024))
+    {
+        qWarning() << qPrintable(QString("Cannot open a binary log file %1!").arg(file_name));
+        delete sink;
+        return;
+    }
+
+    // Called before the writer thread is started, so there are no concurrent writes
+    m_binary_sink = sink;
 }
@@ -6,6 +6,18 @@
 #include <QObject>
 #include <QRegExp>
 #include <QFile>
+#include <QVector>
+#include <QByteArray>
+#include <QAtomicPointer>
+#include <QMutex>
+
+namespace yasem {
+struct LogRecord;
+class LogRingBuffer;
+class BinaryLogSink;
+class RotatingLogFile;
+class LogWriterThread;
+}
 
 class LoggerCore : public QObject
 {
@@ -15,6 +27,10 @@ public:
     virtual ~LoggerCore();
 
     static void initLogFile(QObject* parent);
+    static void initBinaryLog();
+    static void startWriter();
+    static void stopWriter();
+    static void flush();
 
 signals:
 
@@ -25,9 +41,23 @@ public slots:
 
     static void MessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg);
 protected:
+    struct LogTimeCache
+    {
+        LogTimeCache(): second(-1) {}
+        qint64 second;
+        QByteArray text;    // hh:mm:ss:
+    };
+
     static QString colorize(const QString &str);
+    static FILE* formatRecord(const yasem::LogRecord &record, QByteArray &output, LogTimeCache &time_cache);
+    static void writeRecords(const QVector<yasem::LogRecord> &records);
+    static qint64 writeLines(FILE* channel, const QVector<QByteArray> &lines, const QVector<FILE*> &channels);
 
-    static QFile* m_log_file;
+    static yasem::RotatingLogFile* m_log_file;
+    static yasem::BinaryLogSink* m_binary_sink;
+    static yasem::LogRingBuffer* m_queue;
+    static QAtomicPointer<yasem::LogWriterThread> m_writer;
+    static QMutex m_write_mutex;
 
     class Colorizer: public QString {
         QString data;
@@ -0,0 +1,92 @@
+#include "logringbuffer.h"
+
+using namespace yasem;
+
+LogRingBuffer::LogRingBuffer(size_t capacity)
+{
+    // Capacity must be a power of two to use a mask instead of modulo
+    size_t size = 2;
+    while(size < capacity)
+        size <<= 1;
+
+    m_slots = new Slot[size];
+    m_mask = size - 1;
+
+    for(size_t index = 0; index < size; index++)
+        m_slots[index].sequence.store(index, std::memory_order_relaxed);
+
+    m_enqueue_pos.store(0, std::memory_order_relaxed);
+    m_dequeue_pos.store(0, std::memory_order_relaxed);
+}
+
+LogRingBuffer::~LogRingBuffer()
+{
+    delete[] m_slots;
+}
+
+/**
+ * @brief LogRingBuffer::push
+ *
+ * Moves the record into the queue. Returns false if the queue is full.
+ */
+bool LogRingBuffer::push(LogRecord &record)
+{
+    Slot* slot;
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        slot = &m_slots[pos & m_mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if(diff == 0)
+        {
+            if(m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(diff < 0)
+            return false;
+        else
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    }
+
+    slot->record = std::move(record);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief LogRingBuffer::pop
+ *
+ * Moves the oldest record out of the queue. Returns false if the queue is empty.
+ */
+bool LogRingBuffer::pop(LogRecord &record)
+{
+    Slot* slot;
+    size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        slot = &m_slots[pos & m_mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+        if(diff == 0)
+        {
+            if(m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(diff < 0)
+            return false;
+        else
+            pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    }
+
+    record = std::move(slot->record);
+    slot->sequence.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogRingBuffer::isEmpty() const
+{
+    const size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    const Slot& slot = m_slots[pos & m_mask];
+    return (intptr_t)slot.sequence.load(std::memory_order_acquire) - (intptr_t)(pos + 1) < 0;
+}
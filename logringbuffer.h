@@ -0,0 +1,77 @@
+#ifndef LOGRINGBUFFER_H
+#define LOGRINGBUFFER_H
+
+#include "logformat.h"
+
+#include <QByteArray>
+
+#include <atomic>
+
+namespace yasem {
+
+/**
+ * @brief Log message as it's passed from the calling thread to the log writer.
+ *
+ * Nothing is formatted here. File and function are copied only for message
+ * types that print them. Category name is truncated as in the binary log.
+ */
+struct LogRecord
+{
+    LogRecord():
+        type(0),
+        timestamp(0),
+        thread_id(0),
+        line(0)
+    {
+        category[0] = '\0';
+    }
+
+    int type;
+    qint64 timestamp;       // ms since epoch
+    quintptr thread_id;
+    int line;
+    char category[LOG_BINARY_CATEGORY_SIZE];  // Copied, categories of plugins go away with their libraries
+    QByteArray message;
+    QByteArray file;
+    QByteArray function;
+};
+
+/**
+ * @brief Bounded lock-free queue of log records.
+ *
+ * Any number of threads may push records, the log writer thread pops them.
+ * Each slot has a sequence number that tells whether it's free for the
+ * producer with the given position or ready for the consumer
+ * (D. Vyukov's bounded MPMC queue).
+ */
+class LogRingBuffer
+{
+public:
+    explicit LogRingBuffer(size_t capacity);
+    ~LogRingBuffer();
+
+    bool push(LogRecord &record);
+    bool pop(LogRecord &record);
+    bool isEmpty() const;
+
+protected:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    Slot* m_slots;
+    size_t m_mask;
+
+    // Producers and the consumer shouldn't share a cache line
+    alignas(64) std::atomic<size_t> m_enqueue_pos;
+    alignas(64) std::atomic<size_t> m_dequeue_pos;
+
+private:
+    Q_DISABLE_COPY(LogRingBuffer)
+};
+
+}
+
+#endif // LOGRINGBUFFER_H
@@ -0,0 +1,108 @@
+#include "logwriterthread.h"
+#include "crashrecorder.h"
+
+using namespace yasem;
+
+static const int LOG_WRITER_BATCH_SIZE = 256;
+static const int LOG_WRITER_IDLE_TIMEOUT = 100; // ms
+
+LogWriterThread::LogWriterThread(LogRingBuffer *queue, Writer writer, QObject *parent) :
+    QThread(parent),
+    m_queue(queue),
+    m_writer(writer),
+    m_sleeping(false),
+    m_stopped(false),
+    m_enqueued(0),
+    m_written(0)
+{
+    setObjectName("LogWriter");
+}
+
+LogWriterThread::~LogWriterThread()
+{
+    stop();
+}
+
+/**
+ * @brief LogWriterThread::enqueue
+ *
+ * Moves the record into the queue. If the queue is full the caller waits
+ * for the writer instead of dropping messages.
+ */
+void LogWriterThread::enqueue(LogRecord &record)
+{
+    while(!m_queue->push(record))
+    {
+        wake();
+        QThread::yieldCurrentThread();
+    }
+    m_enqueued.fetch_add(1, std::memory_order_release);
+
+    // Pairs with the fence in run(): either the writer sees the record before it sleeps
+    // or we see the flag, acquire/release alone allows both to miss each other
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(m_sleeping.load(std::memory_order_seq_cst))
+        wake();
+}
+
+/**
+ * @brief LogWriterThread::flush
+ *
+ * Waits until everything that has been enqueued before the call is written.
+ */
+void LogWriterThread::flush()
+{
+    const quint64 target = m_enqueued.load(std::memory_order_acquire);
+    while(m_written.load(std::memory_order_acquire) < target && isRunning())
+    {
+        wake();
+        QThread::usleep(100);
+    }
+}
+
+void LogWriterThread::stop()
+{
+    m_stopped.store(true, std::memory_order_release);
+    wake();
+    wait();
+}
+
+void LogWriterThread::wake()
+{
+    QMutexLocker locker(&m_mutex);
+    m_wait_condition.wakeOne();
+}
+
+void LogWriterThread::run()
+{
+    CrashRecorder::installThread();
+
+    QVector<LogRecord> batch;
+    batch.reserve(LOG_WRITER_BATCH_SIZE);
+
+    for(;;)
+    {
+        LogRecord record;
+        while(batch.size() < LOG_WRITER_BATCH_SIZE && m_queue->pop(record))
+            batch.append(std::move(record));
+
+        if(!batch.isEmpty())
+        {
+            m_writer(batch);
+            m_written.fetch_add(batch.size(), std::memory_order_release);
+            batch.resize(0);
+            continue;
+        }
+
+        if(m_stopped.load(std::memory_order_acquire))
+            break;
+
+        QMutexLocker locker(&m_mutex);
+        m_sleeping.store(true, std::memory_order_seq_cst);
+        // A record could be pushed before the flag was set
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(m_queue->isEmpty())
+            m_wait_condition.wait(&m_mutex, LOG_WRITER_IDLE_TIMEOUT);
+        m_sleeping.store(false, std::memory_order_seq_cst);
+    }
+}
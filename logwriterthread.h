@@ -0,0 +1,50 @@
+#ifndef LOGWRITERTHREAD_H
+#define LOGWRITERTHREAD_H
+
+#include "logringbuffer.h"
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+
+#include <atomic>
+#include <functional>
+
+namespace yasem {
+
+/**
+ * @brief Takes log records from the queue and writes them in batches.
+ *
+ * Producers never take a lock unless the writer is sleeping on an empty queue.
+ */
+class LogWriterThread : public QThread
+{
+    Q_OBJECT
+public:
+    typedef std::function<void(const QVector<LogRecord>&)> Writer;
+
+    explicit LogWriterThread(LogRingBuffer* queue, Writer writer, QObject *parent = 0);
+    virtual ~LogWriterThread();
+
+    void enqueue(LogRecord &record);
+    void flush();
+    void stop();
+
+protected:
+    void run();
+    void wake();
+
+    LogRingBuffer* m_queue;
+    Writer m_writer;
+    QMutex m_mutex;
+    QWaitCondition m_wait_condition;
+    std::atomic<bool> m_sleeping;
+    std::atomic<bool> m_stopped;
+    std::atomic<quint64> m_enqueued;
+    std::atomic<quint64> m_written;
+};
+
+}
+
+#endif // LOGWRITERTHREAD_H
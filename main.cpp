@@ -3,8 +3,13 @@
 #include "profilemanageimpl.h"
 #include "datasourcefactoryimpl.h"
 #include "loggercore.h"
+#include "logcategories.h"
+#include "crashrecorder.h"
+#include "stacktrace.h"
+#include "cpuprofiler.h"
 #include "yasemapplication.h"
 #include "profileconfigparserimpl.h"
+#include "startuptracer.h"
 #include "crashhandler.h"
 
 #include <QDebug>
@@ -16,44 +21,71 @@ using namespace yasem;
 #ifdef Q_OS_LINUX
 #ifndef Q_OS_ANDROID
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <QSocketNotifier>
+
+// Termination signals are passed to the event loop through this pipe
+static int s_signal_pipe[2] = { -1, -1 };
 
 void signalHandler(int signal)
 {
-    //print received signal
-    switch(signal){
+    // Only async-signal-safe calls here, the application quits in onTerminationSignal()
+    const int saved_errno = errno;
+    const char code = (char) signal;
+    const ssize_t written = write(s_signal_pipe[1], &code, 1);
+    Q_UNUSED(written)
+    errno = saved_errno;
+}
+
+void onTerminationSignal()
+{
+    char code = 0;
+    if(read(s_signal_pipe[0], &code, 1) != 1)
+        return;
+
+    switch(code){
         case SIGINT: printf("SIGINT\r\n"); break;
-        case SIGKILL: printf("SIGKILL\r\n"); break;
         case SIGQUIT: printf("SIGQUIT\r\n"); break;
-        case SIGSTOP: printf("SIGSTOP\r\n"); break;
         case SIGTERM: printf("SIGTERM\r\n"); break;
-        case SIGSEGV: printf("SIGSEGV\r\n");
-            SDK::Core::printCallStack();
-            abort();
-        break;
-        default:
-            printf("APPLICATION EXITING\r\n");
-            SDK::Core::printCallStack();
-            break;
+        default: printf("APPLICATION EXITING\r\n"); break;
     }
     QCoreApplication::quit();
 }
 
 void setupSignalHandlers()
 {
-     //#ifdef QT_NO_DEBUG
     //configure app's reaction to OS signals
-    struct sigaction act, oact;
-    memset((void*)&act, 0, sizeof(struct sigaction));
-    memset((void*)&oact, 0, sizeof(struct sigaction));
-    act.sa_flags = 0;
-    act.sa_handler = &signalHandler;
-    sigaction(SIGINT, &act, &oact);
-    sigaction(SIGKILL, &act, &oact);
-    sigaction(SIGQUIT, &act, &oact);
-    sigaction(SIGSTOP, &act, &oact);
-    sigaction(SIGTERM, &act, &oact);
-    sigaction(SIGSEGV, &act, &oact);
-   // #endif
+    if(pipe(s_signal_pipe) == 0)
+    {
+        for(int fd: s_signal_pipe)
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        // The handler must never block if nobody reads the pipe
+        fcntl(s_signal_pipe[1], F_SETFL, fcntl(s_signal_pipe[1], F_GETFL) | O_NONBLOCK);
+
+        QSocketNotifier* notifier = new QSocketNotifier(s_signal_pipe[0], QSocketNotifier::Read, qApp);
+        QObject::connect(notifier, &QSocketNotifier::activated, &onTerminationSignal);
+
+        struct sigaction act;
+        memset((void*)&act, 0, sizeof(struct sigaction));
+        act.sa_flags = SA_RESTART;
+        act.sa_handler = &signalHandler;
+        sigemptyset(&act.sa_mask);
+        sigaction(SIGINT, &act, NULL);
+        sigaction(SIGQUIT, &act, NULL);
+        sigaction(SIGTERM, &act, NULL);
+    }
+    else
+        qWarning() << "Cannot create a pipe for signal handlers";
+
+    // Crashes are handled by the flight recorder
+    QString dump_file = QDir::temp().absoluteFilePath(QString("yasem-crash-%1.txt").arg(getpid()));
+    for(const QString& arg: qApp->arguments())
+    {
+        if(arg.startsWith("--crash-dump="))
+            dump_file = arg.mid(arg.indexOf('=') + 1);
+    }
+    CrashRecorder::install(dump_file);
 }
 
 int startErrorRedirect()
@@ -123,27 +155,42 @@ int main(int argc, char *argv[])
 
     qInstallMessageHandler(LoggerCore::MessageHandler);
     YasemApplication a(argc, argv);
+    LogCategories::init(qApp->arguments());
+
+    StartupTracer* tracer = StartupTracer::instance();
+    tracer->init(qApp->arguments());
+    CpuProfiler::instance()->init(qApp->arguments());
 
     LoggerCore::initLogFile(qApp);
+    LoggerCore::initBinaryLog();
+    LoggerCore::startWriter();
 
     #ifdef Q_OS_LINUX
     #ifndef Q_OS_ANDROID
     //int stdout_fd = startErrorRedirect();
-    //setupSignalHandlers();
+    setupSignalHandlers();
+    SetBacktraceRawFrames(qApp->arguments().contains("--raw-backtrace"));
     #endif
     #endif //Q_OS_LINUX
 
+    qint64 phase_start = tracer->now();
     SDK::Core* core = new CoreImpl(qApp);
     SDK::Core::setInstance(core);
     a.setProperty("Core", QVariant::fromValue(core));
+    tracer->addEvent("CoreImpl", phase_start, tracer->now());
+
+    phase_start = tracer->now();
     SDK::Core::instance()->init();
+    tracer->addEvent("Core::init", phase_start, tracer->now());
 
     qDebug() << "Library paths: " << QApplication::libraryPaths();
 
     SDK::ProfileManager::setInstance(new ProfileManageImpl(core));
     a.setProperty("ProfileManager", QVariant::fromValue(SDK::ProfileManager::instance()));
 
+    phase_start = tracer->now();
     SDK::Core::instance()->mountPointChanged();
+    tracer->addEvent("mountPointChanged", phase_start, tracer->now());
 
     qDebug() << "Starting application...";
 
@@ -154,30 +201,40 @@ int main(int argc, char *argv[])
     a.setProperty("DatasourceFactory", QVariant::fromValue(SDK::DatasourceFactory::instance()));
 
 #ifndef STATIC_BUILD
+    phase_start = tracer->now();
     SDK::PluginErrorCodes listResult = SDK::PluginManager::instance()->listPlugins();
+    tracer->addEvent("listPlugins", phase_start, tracer->now());
 #else
     SDK::PLUGIN_ERROR_CODES listResult = SDK::PLUGIN_ERROR_NO_ERROR;
 #endif
     if(listResult == SDK::PLUGIN_ERROR_NO_ERROR)
     {
+        phase_start = tracer->now();
         SDK::PluginErrorCodes initResult = SDK::PluginManager::instance()->initPlugins();
+        tracer->addEvent("initPlugins", phase_start, tracer->now());
         if(initResult != SDK::PLUGIN_ERROR_NO_ERROR)
         {
             qCritical() << "Cannot initialize plugins. Error code" << initResult;
+            LoggerCore::stopWriter();
             return listResult;
         }
     }
     else
     {
         qCritical() << "Cannot list plugins. Error code" << listResult;
+        LoggerCore::stopWriter();
         return listResult;
     }
 
+    tracer->finish();
+
     qApp->setQuitOnLastWindowClosed(true);
     const int execCode = a.exec();
     qDebug() <<  "Closing application... code:"  << execCode;
 
     SDK::PluginManager::instance()->deinitPlugins();
+    CpuProfiler::instance()->finish();
+    LoggerCore::stopWriter();
 
     #ifdef Q_OS_LINUX
     //stopErrorRedirect(stdout_fd);
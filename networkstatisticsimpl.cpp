@@ -1,12 +1,17 @@
 #include "networkstatisticsimpl.h"
 #include "statistics.h"
 #include "macros.h"
+#include "logcategories.h"
+#include "configimpl.h"
+#include "configkeys.h"
 
 using namespace yasem;
 
 NetworkStatisticsImpl::NetworkStatisticsImpl(SDK::Statistics* statistics):
     SDK::NetworkStatistics(statistics),
     m_statistics(statistics),
+    m_enabled(NULL),
+    m_slow_request_timeout(NULL),
     m_total_count(0),
     m_successful_count(0),
     m_failed_count(0),
@@ -21,17 +26,38 @@ NetworkStatisticsImpl::~NetworkStatisticsImpl()
 
 }
 
+/**
+ * @brief NetworkStatisticsImpl::bindConfig
+ *
+ * Binds the settings to their config items. Should be called once the items are created.
+ */
+void NetworkStatisticsImpl::bindConfig(ConfigImpl *config)
+{
+    m_enabled = &config->slot(ConfigKeys::NETWORK_STATISTICS_ENABLED_KEY);
+    m_slow_request_timeout = &config->slot(ConfigKeys::NETWORK_STATISTICS_SLOW_REQ_TIMEOUT_KEY);
+}
+
+bool NetworkStatisticsImpl::isEnabled() const
+{
+    return m_enabled != NULL ? m_enabled->value() : ConfigKeys::NETWORK_STATISTICS_ENABLED_KEY.default_value;
+}
+
+int NetworkStatisticsImpl::slowRequestTimeout() const
+{
+    return m_slow_request_timeout != NULL ? m_slow_request_timeout->value() : ConfigKeys::NETWORK_STATISTICS_SLOW_REQ_TIMEOUT_KEY.default_value;
+}
+
 void NetworkStatisticsImpl::print() const
 {
-    DEBUG() << "=============== STATISTICS ==============";
-    DEBUG() << "----------------- NETWORK ---------------";
-    DEBUG() << " Total requests:" <<totalCount();
-    DEBUG() << " Successful requests:" << successfulCount();
-    DEBUG() << " Failed requests:" << failedCount();
-    DEBUG() << " Slow requests:" << tooSlowConnectionsCount();
-    DEBUG() << " Pending requests:" << pendingConnectionsCount();
-    DEBUG() << "-----------------------------------------";
-    DEBUG() << "=========================================";
+    NETWORK_DEBUG() << "=============== STATISTICS ==============";
+    NETWORK_DEBUG() << "----------------- NETWORK ---------------";
+    NETWORK_DEBUG() << " Total requests:" <<totalCount();
+    NETWORK_DEBUG() << " Successful requests:" << successfulCount();
+    NETWORK_DEBUG() << " Failed requests:" << failedCount();
+    NETWORK_DEBUG() << " Slow requests:" << tooSlowConnectionsCount();
+    NETWORK_DEBUG() << " Pending requests:" << pendingConnectionsCount();
+    NETWORK_DEBUG() << "-----------------------------------------";
+    NETWORK_DEBUG() << "=========================================";
 }
 
 void yasem::NetworkStatisticsImpl::reset()
@@ -46,18 +72,21 @@ void yasem::NetworkStatisticsImpl::reset()
 
 void NetworkStatisticsImpl::incTotalCount()
 {
+    if(!isEnabled()) return;
     m_total_count++;
     emit totalCountIncreased();
 }
 
 void NetworkStatisticsImpl::intSuccessfulCount()
 {
+    if(!isEnabled()) return;
     m_successful_count++;
     emit successfulCountIncreased();
 }
 
 void NetworkStatisticsImpl::incFailedCount()
 {
+    if(!isEnabled()) return;
     m_failed_count++;
     emit failedCountIncreased();
 }
@@ -77,6 +106,7 @@ void NetworkStatisticsImpl::decPendingConnections()
 
 void NetworkStatisticsImpl::incTooSlowConnections()
 {
+    if(!isEnabled()) return;
     m_too_slow_connections++;
     emit tooSlowCountIncreased();
 }
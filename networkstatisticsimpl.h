@@ -2,6 +2,7 @@
 #define NETWORKSTATISTICSIMPL_H
 
 #include "networkstatistics.h"
+#include "configkey.h"
 
 namespace yasem {
 
@@ -9,12 +10,18 @@ namespace SDK {
 class Statistics;
 }
 
+class ConfigImpl;
+
 class NetworkStatisticsImpl: public SDK::NetworkStatistics
 {
 public:
     NetworkStatisticsImpl(SDK::Statistics* statistics);
     virtual ~NetworkStatisticsImpl();
 
+    void bindConfig(ConfigImpl* config);
+    bool isEnabled() const;
+    int slowRequestTimeout() const;
+
     // NetworkStatistics interface
 public slots:
     void print() const;
@@ -33,6 +40,9 @@ public slots:
 
 protected:
     SDK::Statistics* m_statistics;
+    // Read on every request, so they're bound to config items once
+    const ConfigSlot<bool>* m_enabled;
+    const ConfigSlot<int>* m_slow_request_timeout;
     quint32 m_total_count;
     quint32 m_successful_count;
     quint32 m_failed_count;
@@ -0,0 +1,127 @@
+#include "plugindependencygraph.h"
+#include "plugindependency.h"
+
+#include <QQueue>
+#include <QSet>
+
+using namespace yasem;
+
+PluginDependencyGraph::PluginDependencyGraph()
+{
+
+}
+
+void PluginDependencyGraph::build(const QList<QSharedPointer<SDK::Plugin>> &plugins)
+{
+    clear();
+
+    for(const QSharedPointer<SDK::Plugin>& plugin: plugins)
+    {
+        for(SDK::PluginRole role: plugin->roles().keys())
+            m_role_providers[role].append(plugin.data());
+    }
+
+    QHash<SDK::Plugin*, int> in_degree;
+    for(const QSharedPointer<SDK::Plugin>& plugin: plugins)
+    {
+        QList<SDK::Plugin*>& providers = m_providers[plugin.data()];
+        for(const SDK::PluginDependency& dep: plugin->dependencies())
+        {
+            for(SDK::Plugin* provider: m_role_providers.value(dep.getRole()))
+            {
+                if(provider == plugin.data() || providers.contains(provider)) continue;
+                providers.append(provider);
+                m_dependents[provider].append(plugin.data());
+            }
+        }
+        in_degree.insert(plugin.data(), providers.size());
+    }
+
+    QQueue<SDK::Plugin*> ready;
+    for(const QSharedPointer<SDK::Plugin>& plugin: plugins)
+    {
+        if(in_degree.value(plugin.data()) == 0)
+            ready.enqueue(plugin.data());
+    }
+
+    while(!ready.isEmpty())
+    {
+        SDK::Plugin* plugin = ready.dequeue();
+        m_order.append(plugin);
+        for(SDK::Plugin* dependent: m_dependents.value(plugin))
+        {
+            if(--in_degree[dependent] == 0)
+                ready.enqueue(dependent);
+        }
+    }
+
+    for(const QSharedPointer<SDK::Plugin>& plugin: plugins)
+    {
+        if(in_degree.value(plugin.data()) > 0)
+            m_cyclic.append(plugin.data());
+    }
+}
+
+void PluginDependencyGraph::clear()
+{
+    m_role_providers.clear();
+    m_providers.clear();
+    m_dependents.clear();
+    m_order.clear();
+    m_cyclic.clear();
+}
+
+const QList<SDK::Plugin*>& PluginDependencyGraph::order() const
+{
+    return m_order;
+}
+
+const QList<SDK::Plugin*>& PluginDependencyGraph::cyclic() const
+{
+    return m_cyclic;
+}
+
+/**
+ * @brief PluginDependencyGraph::cycle
+ *
+ * Returns providers of the plugin that are in the same dependency cycle,
+ * i.e. providers that depend on the plugin themselves (maybe indirectly).
+ */
+QList<SDK::Plugin*> PluginDependencyGraph::cycle(SDK::Plugin *plugin) const
+{
+    QSet<SDK::Plugin*> reachable;
+    QQueue<SDK::Plugin*> queue;
+    queue.enqueue(plugin);
+    while(!queue.isEmpty())
+    {
+        for(SDK::Plugin* dependent: m_dependents.value(queue.dequeue()))
+        {
+            if(reachable.contains(dependent)) continue;
+            reachable.insert(dependent);
+            queue.enqueue(dependent);
+        }
+    }
+
+    QList<SDK::Plugin*> result;
+    for(SDK::Plugin* provider: m_providers.value(plugin))
+    {
+        if(reachable.contains(provider))
+            result.append(provider);
+    }
+    return result;
+}
+
+QList<SDK::Plugin*> PluginDependencyGraph::providers(SDK::Plugin *plugin) const
+{
+    return m_providers.value(plugin);
+}
+
+QList<SDK::Plugin*> PluginDependencyGraph::dependents(SDK::Plugin *plugin) const
+{
+    return m_dependents.value(plugin);
+}
+
+QList<SDK::Plugin*> PluginDependencyGraph::roleProviders(SDK::PluginRole role) const
+{
+    return m_role_providers.value(role);
+}
@@ -0,0 +1,46 @@
+#ifndef PLUGINDEPENDENCYGRAPH_H
+#define PLUGINDEPENDENCYGRAPH_H
+
+#include "plugin.h"
+
+#include <QList>
+#include <QHash>
+#include <QSharedPointer>
+
+namespace yasem {
+
+/**
+ * @brief Role dependency graph of loaded plugins.
+ *
+ * There is an edge from plugin A to plugin B if B depends on a role A provides.
+ * The graph is built once before initialization. Plugins are sorted
+ * topologically (Kahn's algorithm), plugins that are a part of a dependency
+ * cycle (or depend on such plugins) can't be sorted and are reported by cyclic().
+ */
+class PluginDependencyGraph
+{
+public:
+    PluginDependencyGraph();
+
+    void build(const QList<QSharedPointer<SDK::Plugin>> &plugins);
+    void clear();
+
+    const QList<SDK::Plugin*>& order() const;
+    const QList<SDK::Plugin*>& cyclic() const;
+    QList<SDK::Plugin*> cycle(SDK::Plugin* plugin) const;
+
+    QList<SDK::Plugin*> providers(SDK::Plugin* plugin) const;
+    QList<SDK::Plugin*> dependents(SDK::Plugin* plugin) const;
+    QList<SDK::Plugin*> roleProviders(SDK::PluginRole role) const;
+
+protected:
+    QHash<SDK::PluginRole, QList<SDK::Plugin*>> m_role_providers;
+    QHash<SDK::Plugin*, QList<SDK::Plugin*>> m_providers;
+    QHash<SDK::Plugin*, QList<SDK::Plugin*>> m_dependents;
+    QList<SDK::Plugin*> m_order;
+    QList<SDK::Plugin*> m_cyclic;
+};
+
+}
+
+#endif // PLUGINDEPENDENCYGRAPH_H
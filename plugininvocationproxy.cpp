@@ -0,0 +1,75 @@
+#include "plugininvocationproxy.h"
+
+#include <QThread>
+#include <QSemaphore>
+#include <QCoreApplication>
+
+using namespace yasem;
+
+static const QEvent::Type PLUGIN_INVOCATION_EVENT = (QEvent::Type)QEvent::registerEventType();
+
+class PluginInvocationEvent: public QEvent
+{
+public:
+    PluginInvocationEvent(std::function<void()> func, QSemaphore* done):
+        QEvent(PLUGIN_INVOCATION_EVENT),
+        m_func(func),
+        m_done(done)
+    {}
+
+    virtual ~PluginInvocationEvent()
+    {
+        // Release the caller even if the event has been discarded
+        if(m_done != NULL)
+            m_done->release();
+    }
+
+    void run()
+    {
+        m_func();
+    }
+
+protected:
+    std::function<void()> m_func;
+    QSemaphore* m_done;
+};
+
+PluginInvocationProxy::PluginInvocationProxy(QObject *parent) :
+    QObject(parent)
+{
+
+}
+
+PluginInvocationProxy::~PluginInvocationProxy()
+{
+
+}
+
+void PluginInvocationProxy::invoke(std::function<void()> func, bool wait)
+{
+    if(thread() == QThread::currentThread())
+    {
+        func();
+        return;
+    }
+
+    if(!wait)
+    {
+        QCoreApplication::postEvent(this, new PluginInvocationEvent(func, NULL));
+        return;
+    }
+
+    QSemaphore done;
+    QCoreApplication::postEvent(this, new PluginInvocationEvent(func, &done));
+    done.acquire();
+}
+
+bool PluginInvocationProxy::event(QEvent *event)
+{
+    if(event->type() == PLUGIN_INVOCATION_EVENT)
+    {
+        static_cast<PluginInvocationEvent*>(event)->run();
+        return true;
+    }
+    return QObject::event(event);
+}
@@ -0,0 +1,40 @@
+#ifndef PLUGININVOCATIONPROXY_H
+#define PLUGININVOCATIONPROXY_H
+
+#include <QObject>
+#include <QEvent>
+
+#include <functional>
+
+namespace yasem {
+
+typedef std::function<void()> PluginInvocation;
+
+/**
+ * @brief Runs functions in the thread the proxy lives in.
+ *
+ * Used to call plugins that are hosted in their own threads (@see PluginThread).
+ * If the caller is already in the proxy's thread the function is called directly,
+ * otherwise it's posted to the thread's event loop.
+ *
+ * Blocking calls between two threads that wait for each other will deadlock,
+ * so plugin threads should use non-blocking calls to the main thread.
+ */
+class PluginInvocationProxy : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PluginInvocationProxy(QObject *parent = 0);
+    virtual ~PluginInvocationProxy();
+
+    void invoke(std::function<void()> func, bool wait = true);
+
+protected:
+    bool event(QEvent *event);
+};
+
+}
+
+Q_DECLARE_METATYPE(yasem::PluginInvocation)
+
+#endif // PLUGININVOCATIONPROXY_H
@@ -7,6 +7,9 @@
 #include "yasemsettings.h"
 #include "gui.h"
 #include "configuration_items.h"
+#include "startuptracer.h"
+#include "logcategories.h"
+#include "configimpl.h"
 
 #include <QDir>
 #include <QDebug>
@@ -19,6 +22,8 @@
 #include <QtCore/QCoreApplication>
 #include <QSettings>
 #include <QThread>
+#include <QReadLocker>
+#include <QWriteLocker>
 
 using namespace yasem;
 
@@ -29,9 +34,15 @@ static const QString PLUGIN_FLAG_NAME_GUI    = "gui";
 
 PluginManagerImpl::PluginManagerImpl(SDK::Core* core):
     PluginManager(core),
-    m_plugins_config(SDK::__get_config_item<SDK::ConfigContainer*>(SETTINGS_GROUP_PLUGINS))
+    m_plugins_config(SDK::__get_config_item<SDK::ConfigContainer*>(SETTINGS_GROUP_PLUGINS)),
+    m_metadata_cache(new PluginMetadataCache(core->getConfigDir().append("plugins.cache"))),
+    m_parallel_init(!core->arguments().contains("--no-parallel-init")),
+    m_init_scheduler_active(false),
+    m_init_serial(0),
+    m_main_thread_proxy(new PluginInvocationProxy(this))
 {
    this->setObjectName("PluginManager");
+   qRegisterMetaType<PluginInvocation>();
 #ifdef USE_OSX_BUNDLE
    setPluginDir("Plugins");
 #else
@@ -70,15 +81,32 @@ PluginManagerImpl::PluginManagerImpl(SDK::Core* core):
 PluginManagerImpl::~PluginManagerImpl()
 {
     STUB();
+    // Threads must not run plugins that are going to be deleted
+    m_threads_mutex.lock();
+    const QList<SDK::Plugin*> threaded_plugins = m_plugin_threads.keys();
+    m_threads_mutex.unlock();
+    for(SDK::Plugin* plugin: threaded_plugins)
+        stopPluginThread(plugin);
+
+    qDeleteAll(m_plugin_catalogue);
+    delete m_metadata_cache;
 }
 
 SDK::PluginErrorCodes PluginManagerImpl::listPlugins()
 {
-    DEBUG() << "Looking for plugins...";
+    PLUGINS_DEBUG() << "Looking for plugins...";
 
-    DEBUG() << "PluginManager::listPlugins()";
-    QStringList pluginIds;
+    PLUGINS_DEBUG() << "PluginManager::listPlugins()";
+    QWriteLocker locker(&m_registry_lock);
     m_plugins.clear();
+    m_role_plugins.clear();
+    m_active_role_plugins.clear();
+    m_role_objects.clear();
+    m_iid_index.clear();
+    qDeleteAll(m_plugin_catalogue);
+    m_plugin_catalogue.clear();
+    m_plugin_catalogue_index.clear();
+    locker.unlock();
 
     QDir pluginsDir(qApp->applicationDirPath());
     #if defined(Q_OS_WIN)
@@ -98,111 +126,200 @@ SDK::PluginErrorCodes PluginManagerImpl::listPlugins()
         return SDK::PLUGIN_ERROR_DIR_NOT_FOUND;
     }
 
-    DEBUG() << "Searching for plugins in" << pluginsDir.path();
+    PLUGINS_DEBUG() << "Searching for plugins in" << pluginsDir.path();
 
+    m_metadata_cache->open();
+
+    // Only metadata is read here. Plugin libraries are loaded later in initPlugins()
+    // and only if they are enabled in config.
     foreach (QString fileName, pluginsDir.entryList(QDir::Files | QDir::NoSymLinks | QDir::Readable))
     {
+        const QString file_path = pluginsDir.absoluteFilePath(fileName);
+        PluginMetadata* info = new PluginMetadata();
+        if(!m_metadata_cache->lookup(file_path, info))
+        {
+            if(!readPluginMetadata(file_path, info))
+            {
+                delete info;
+                continue;
+            }
+            m_metadata_cache->update(info);
+        }
 
-        QPluginLoader pluginLoader(pluginsDir.absoluteFilePath(fileName));
+        if(m_plugin_catalogue_index.contains(info->id))
+        {
+            WARN() << "Plugin" << info->id << "from" << fileName << "has been already found in"
+                   << m_plugin_catalogue_index.value(info->id)->file_name << ". Skipping.";
+            delete info;
+            continue;
+        }
 
-        SDK::Plugin *plugin = qobject_cast<SDK::Plugin*>(pluginLoader.instance());
+        PLUGINS_DEBUG() << "....Plugin found:" << info->name << "in" << fileName;
 
-        if (plugin != NULL)
-        {
-            qDebug() << "Loading plugin from file" << fileName;
-            QJsonObject metadata = pluginLoader.metaData().value("MetaData").toObject();
-            QString id = metadata.value("id").toString();
+        m_plugin_catalogue.append(info);
+        m_plugin_catalogue_index.insert(info->id, info);
 
-            if(!pluginIds.contains(id))
-            {
-                plugin->setActive(true);
+        SDK::ConfigItem* plugin_info = new SDK::ConfigItem(info->id, info->name, true, SDK::ConfigItem::BOOL);
+        m_plugins_config->addItem(plugin_info);
+    }
+    m_metadata_cache->save();
 
-                QString name = metadata.value("name").toString();
-                QString version = metadata.value("version").toString();
-                QString type = metadata.value("type").toString();
+    // Plugins group is loaded here once all plugin items have been added
+    ConfigImpl* config = static_cast<ConfigImpl*>(SDK::Core::instance()->yasem_settings());
+    config->load(m_plugins_config);
+    for(PluginMetadata* info: m_plugin_catalogue)
+        info->enabled = &config->slot<bool>(QString(m_plugins_config->getKey()).append('/').append(info->id), true);
 
-                plugin->setIID(pluginLoader.metaData().value("IID").toString());
-                plugin->setClassName(pluginLoader.metaData().value("className").toString());
-                plugin->setMetadata(metadata);
-                plugin->setId(id);
-                plugin->setName(name);
-                plugin->setState(SDK::PLUGIN_STATE_NOT_INITIALIZED);
-                plugin->setFlags(parseFlags(metadata.value("flags").toString()));
+    return SDK::PLUGIN_ERROR_NO_ERROR;
+}
 
-                DEBUG() << "....Registering plugin roles...";
-                plugin->register_roles();
-                DEBUG() << "....Registering plugin dependencies...";
-                plugin->register_dependencies();
+/**
+ * @brief PluginManagerImpl::readPluginMetadata
+ *
+ * Reads JSON metadata embedded into the plugin file.
+ * QPluginLoader::metaData() doesn't load the library, so it's cheap
+ * comparing to QPluginLoader::instance().
+ */
+bool PluginManagerImpl::readPluginMetadata(const QString &fileName, PluginMetadata* info)
+{
+    QPluginLoader pluginLoader(fileName);
+    QJsonObject loader_metadata = pluginLoader.metaData();
+    QJsonObject metadata = loader_metadata.value("MetaData").toObject();
 
-                pluginIds.append(id);
-                m_plugins.append(QSharedPointer<SDK::Plugin>(plugin));
+    if(loader_metadata.isEmpty() || metadata.value("id").toString().isEmpty())
+    {
+        WARN() << "File" << fileName << "is not a valid plugin";
+        return false;
+    }
 
-                DEBUG() << "....Plugin loaded:" << plugin->getName();
+    info->file_name     = fileName;
+    info->iid           = loader_metadata.value("IID").toString();
+    info->class_name    = loader_metadata.value("className").toString();
+    info->metadata      = metadata;
+    info->id            = metadata.value("id").toString();
+    info->name          = metadata.value("name").toString();
+    info->version       = metadata.value("version").toString();
+    info->revision      = metadata.value("revision").toString();
+    info->flags         = parseFlags(metadata.value("flags").toString());
 
-                connect(plugin, &SDK::Plugin::loaded, this, &PluginManagerImpl::onPluginLoaded);
-                connect(plugin, &SDK::Plugin::unloaded, this, &PluginManagerImpl::onPluginUnloaded);
-                connect(plugin, &SDK::Plugin::initialized, this, &PluginManagerImpl::onPluginInitialized);
-                connect(plugin, &SDK::Plugin::deinitialized, this, &PluginManagerImpl::onPluginDeinitialized);
+    return true;
+}
 
-                SDK::ConfigItem* plugin_info = new SDK::ConfigItem(plugin->getId(), plugin->getName(), true, SDK::ConfigItem::BOOL);
-                m_plugins_config->addItem(plugin_info);
-            }
-        }
-        else
-        {
-           WARN() << pluginLoader.errorString();
-        }
+/**
+ * @brief PluginManagerImpl::instantiatePlugin
+ *
+ * Loads plugin library and creates plugin instance from catalogue entry.
+ * Does nothing if the plugin has been already instantiated.
+ */
+QSharedPointer<SDK::Plugin> PluginManagerImpl::instantiatePlugin(PluginMetadata* info)
+{
+    if(info->plugin) return info->plugin;
+
+    qDebug() << "Loading plugin from file" << info->file_name;
+    QPluginLoader* pluginLoader = new QPluginLoader(info->file_name, this);
+    SDK::Plugin *plugin = NULL;
+    {
+        StartupTraceScope trace(TRACE_PLUGIN_LOAD, info->id);
+        plugin = qobject_cast<SDK::Plugin*>(pluginLoader->instance());
     }
-    SDK::Core::instance()->yasem_settings()->load(m_plugins_config);
-    return SDK::PLUGIN_ERROR_NO_ERROR;
-}
 
+    if(plugin == NULL)
+    {
+        WARN() << pluginLoader->errorString();
+        delete pluginLoader;
+        return QSharedPointer<SDK::Plugin>();
+    }
 
-QList<QSharedPointer<SDK::Plugin>> PluginManagerImpl::getPlugins(SDK::PluginRole role, bool active_only)
-{
-    DEBUG() << QString("getPlugins(role: %1, active only: %2)").arg(role).arg(active_only);
+    info->loader = pluginLoader;
 
-    QList<QSharedPointer<SDK::Plugin>> result;
-    foreach(QSharedPointer<SDK::Plugin> plugin, m_plugins)
+    plugin->setActive(true);
+    plugin->setIID(info->iid);
+    plugin->setClassName(info->class_name);
+    plugin->setMetadata(info->metadata);
+    plugin->setId(info->id);
+    plugin->setName(info->name);
+    plugin->setState(isPluginEnabled(info) ? SDK::PLUGIN_STATE_NOT_INITIALIZED : SDK::PLUGIN_STATE_DISABLED);
+    plugin->setFlags(info->flags);
+
+    PLUGIN_DEBUG(info->id) << "....Registering plugin roles...";
     {
-        bool add_this = false;
-        foreach(SDK::PluginRole pluginRole, plugin->roles().keys())
-        {
-            if(pluginRole == role || role == SDK::ROLE_ANY)
-            {
-                add_this = !active_only || plugin->isActive();
-            }
-        }
+        StartupTraceScope trace(TRACE_PLUGIN_ROLES, info->id);
+        LogCategories::PluginScope log_scope(info->id);
+        plugin->register_roles();
+    }
+    PLUGIN_DEBUG(info->id) << "....Registering plugin dependencies...";
+    {
+        StartupTraceScope trace(TRACE_PLUGIN_DEPENDENCIES, info->id);
+        LogCategories::PluginScope log_scope(info->id);
+        plugin->register_dependencies();
+    }
+
+    info->plugin = QSharedPointer<SDK::Plugin>(plugin);
+    m_registry_lock.lockForWrite();
+    m_plugins.append(info->plugin);
+    m_registry_lock.unlock();
+    addToPluginIndex(info->plugin);
+
+    PLUGIN_DEBUG(info->id) << "....Plugin loaded:" << plugin->getName();
+
+    connect(plugin, &SDK::Plugin::loaded, this, &PluginManagerImpl::onPluginLoaded);
+    connect(plugin, &SDK::Plugin::unloaded, this, &PluginManagerImpl::onPluginUnloaded);
+    connect(plugin, &SDK::Plugin::initialized, this, &PluginManagerImpl::onPluginInitialized);
+    connect(plugin, &SDK::Plugin::deinitialized, this, &PluginManagerImpl::onPluginDeinitialized);
+    connect(plugin, &SDK::Plugin::error_happened, this, &PluginManagerImpl::onPluginError);
+
+    return info->plugin;
+}
 
-        if(add_this) result.append(plugin);
+/**
+ * @brief PluginManagerImpl::instantiateDisabledPlugins
+ *
+ * Disabled plugins aren't loaded by initPlugins(). They're loaded here
+ * (without initialization) only when somebody asks for inactive plugins.
+ * Should be called from the main thread only.
+ */
+void PluginManagerImpl::instantiateDisabledPlugins()
+{
+    for(PluginMetadata* info: m_plugin_catalogue)
+    {
+        if(!info->plugin && !isPluginEnabled(info))
+            instantiatePlugin(info);
     }
+}
 
-    return result;
+bool PluginManagerImpl::isPluginEnabled(const QString &id)
+{
+    return isPluginEnabled(m_plugin_catalogue_index.value(id, NULL));
+}
+
+bool PluginManagerImpl::isPluginEnabled(const PluginMetadata *info)
+{
+    return info != NULL && info->enabled != NULL && info->enabled->value();
+}
+
+const QList<PluginMetadata*>& PluginManagerImpl::getPluginCatalogue() const
+{
+    return m_plugin_catalogue;
+}
+
+QList<QSharedPointer<SDK::Plugin>> PluginManagerImpl::getPlugins(SDK::PluginRole role, bool active_only)
+{
+    // Settings UI lists disabled plugins too
+    if(!active_only && QThread::currentThread() == thread())
+        instantiateDisabledPlugins();
+
+    // Lists are implicitly shared, so returning a copy doesn't touch the plugins' reference counters
+    QReadLocker locker(&m_registry_lock);
+    return pluginsByRole(role, active_only);
 }
 
 SDK::AbstractPluginObject* PluginManagerImpl::getByRole(SDK::PluginRole role, bool show_warning)
 {
-    QList<SDK::AbstractPluginObject*> list = m_plugin_objects.value(role);
-    if(!list.isEmpty())
-        return list.first(); // TODO: Add some criteria to select
-    for(int index = 0; index < m_plugins.size(); index++)
     {
-        QSharedPointer<SDK::Plugin> plugin = m_plugins.at(index);
-        if(!plugin->isActive()) continue;
-        for(SDK::PluginRole pluginRole: plugin->roles().keys())
-        {
-            if(pluginRole == role)
-            {
-                Q_ASSERT(plugin);
-                SDK::AbstractPluginObject* obj = plugin->roles().value(pluginRole);
-                if(obj->isInitialized())
-                {
-                    list.append(obj);
-                    m_plugin_objects.insert(role, list);
-                    return obj;
-                }
-            }
-        }
+        QReadLocker locker(&m_registry_lock);
+        const QVector<SDK::AbstractPluginObject*>& list = objectsByRole(role);
+        if(!list.isEmpty())
+            return list.first(); // TODO: Add some criteria to select
     }
 
     if(show_warning)
@@ -213,16 +330,111 @@ SDK::AbstractPluginObject* PluginManagerImpl::getByRole(SDK::PluginRole role, bo
 
 QSharedPointer<SDK::Plugin> PluginManagerImpl::getByIID(const QString &iid)
 {
-    for(int index = 0; index < m_plugins.size(); index++)
+    QReadLocker locker(&m_registry_lock);
+    return m_iid_index.value(iid);
+}
+
+/**
+ * @brief PluginManagerImpl::objectsByRole
+ *
+ * Returns objects of initialized plugins that implement the role.
+ * The list is owned by PluginManager and changes when plugins are (de)initialized,
+ * so m_registry_lock should be held while it's used.
+ */
+const QVector<SDK::AbstractPluginObject*>& PluginManagerImpl::objectsByRole(SDK::PluginRole role) const
+{
+    static const QVector<SDK::AbstractPluginObject*> empty;
+    auto iterator = m_role_objects.constFind(role);
+    return iterator != m_role_objects.constEnd() ? iterator.value() : empty;
+}
+
+/**
+ * @brief PluginManagerImpl::pluginsByRole
+ *
+ * Returns loaded plugins that have the role (plugins with any role for SDK::ROLE_ANY).
+ * The list is owned by PluginManager, so m_registry_lock should be held while it's used.
+ */
+const QList<QSharedPointer<SDK::Plugin>>& PluginManagerImpl::pluginsByRole(SDK::PluginRole role, bool active_only) const
+{
+    static const QList<QSharedPointer<SDK::Plugin>> empty;
+    const QHash<SDK::PluginRole, QList<QSharedPointer<SDK::Plugin>>>& index = active_only ? m_active_role_plugins : m_role_plugins;
+    auto iterator = index.constFind(role);
+    return iterator != index.constEnd() ? iterator.value() : empty;
+}
+
+void PluginManagerImpl::addToPluginIndex(const QSharedPointer<SDK::Plugin> &plugin)
+{
+    // Plugins without roles are not listed for SDK::ROLE_ANY either
+    QList<SDK::PluginRole> roles = plugin->roles().keys();
+    if(!roles.isEmpty())
+        roles.prepend(SDK::ROLE_ANY);
+
+    m_registry_lock.lockForWrite();
+    for(SDK::PluginRole role: roles)
+    {
+        QList<QSharedPointer<SDK::Plugin>>& list = m_role_plugins[role];
+        if(!list.contains(plugin))
+            list.append(plugin);
+    }
+    m_registry_lock.unlock();
+    updatePluginIndex(plugin.data());
+}
+
+/**
+ * @brief PluginManagerImpl::updatePluginIndex
+ *
+ * Should be called after each plugin's state transition to keep role and IID indices actual.
+ * Plugin threads read the indices, so they're changed under m_registry_lock.
+ */
+void PluginManagerImpl::updatePluginIndex(SDK::Plugin *plugin)
+{
+    QWriteLocker locker(&m_registry_lock);
+    const bool active = plugin->isActive() && plugin->getState() != SDK::PLUGIN_STATE_DISABLED;
+    const bool initialized = active && plugin->getState() == SDK::PLUGIN_STATE_INITIALIZED;
+    PluginMetadata* info = m_plugin_catalogue_index.value(plugin->getId());
+    if(info == NULL || info->plugin.data() != plugin) return;
+    const QSharedPointer<SDK::Plugin>& plugin_ptr = info->plugin;
+
+    QList<SDK::PluginRole> roles = plugin->roles().keys();
+    for(SDK::PluginRole role: roles)
     {
-        QSharedPointer<SDK::Plugin> plugin = m_plugins.at(index);
-        if(!plugin->isActive()) continue;
-        if(plugin->getIID() == iid)
+        SDK::AbstractPluginObject* object = plugin->roles().value(role);
+        QVector<SDK::AbstractPluginObject*>& objects = m_role_objects[role];
+        int index = objects.indexOf(object);
+        if(initialized && index < 0)
+            objects.append(object);
+        else if(!initialized && index >= 0)
+            objects.remove(index);
+    }
+
+    if(!roles.isEmpty())
+        roles.prepend(SDK::ROLE_ANY);
+    for(SDK::PluginRole role: roles)
+    {
+        QList<QSharedPointer<SDK::Plugin>>& list = m_active_role_plugins[role];
+        int index = list.indexOf(plugin_ptr);
+        if(active && index < 0)
+            list.append(plugin_ptr);
+        else if(!active && index >= 0)
+            list.removeAt(index);
+    }
+
+    // Several plugins may implement the same interface, the first active one wins
+    const QString iid = plugin->getIID();
+    if(active && !m_iid_index.contains(iid))
+        m_iid_index.insert(iid, plugin_ptr);
+    else if(!active && m_iid_index.value(iid) == plugin_ptr)
+    {
+        m_iid_index.remove(iid);
+        for(const QSharedPointer<SDK::Plugin>& pl: m_plugins)
         {
-            return plugin;
+            if(pl != plugin_ptr && pl->isActive() && pl->getState() != SDK::PLUGIN_STATE_DISABLED && pl->getIID() == iid)
+            {
+                m_iid_index.insert(iid, pl);
+                break;
+            }
         }
     }
-    return QSharedPointer<SDK::Plugin>(NULL);
 }
 
 SDK::PluginFlag PluginManagerImpl::parseFlags(const QString &flagsStr)
@@ -322,48 +534,47 @@ bool PluginManagerImpl::pluginHasConflicts(SDK::Plugin *plugin)
 
 SDK::PluginErrorCodes PluginManagerImpl::initPlugins()
 {
-    DEBUG() << "initPlugins()";
+    PLUGINS_DEBUG() << "initPlugins()";
 
-    if(m_plugins.size() == 0)
+    if(m_plugin_catalogue.size() == 0)
         return SDK::PLUGIN_ERROR_NOT_INITIALIZED;
 
-    for(QSharedPointer<SDK::Plugin>& plugin: m_plugins)
+    for(PluginMetadata* info: m_plugin_catalogue)
     {
-        for(SDK::PluginDependency dep: plugin->dependencies())
+        if(!isPluginEnabled(info))
         {
-            for(QSharedPointer<SDK::Plugin>& pl: m_plugins)
-            {
-                if(pl == plugin) continue;
-
-                if(pl->has_role(dep.getRole()))
-                {
-                    connect(pl.data(), &SDK::Plugin::initialized, [=]() {
-                        initializePlugin(plugin.data(), true);
-                    });
-                    connect(pl.data(), &SDK::Plugin::deinitialized, [=]() {
-                        deinitializePlugin(plugin.data());
-                    });
-                    connect(pl.data(), &SDK::Plugin::error_happened, [=, &dep]() {
-                        if(dep.isRequired())
-                            deinitializePlugin(plugin.data());
-                        else if(dep.doSkipIfFailed())
-                            initializePlugin(plugin.data());
-                    });
-                }
-            }
+            PLUGINS_DEBUG() << "Plugin" << info->name << "is disabled in config. Skipping.";
+            continue;
         }
+        instantiatePlugin(info);
     }
 
-    for(QSharedPointer<SDK::Plugin>& plugin: m_plugins)
+    m_dependency_graph.build(m_plugins);
+    for(SDK::Plugin* plugin: m_dependency_graph.cyclic())
+    {
+        // Plugins that only depend on a cycle are reported by the cycle members
+        QStringList names;
+        for(SDK::Plugin* provider: m_dependency_graph.cycle(plugin))
+            names.append(provider->getName());
+        if(names.isEmpty()) continue;
+        WARN() << qPrintable(QString("Circular dependencies %1 <-> %2").arg(plugin->getName()).arg(names.join(", ")));
+    }
+
+    runInitializationSchedule();
+
+    // Plugins from dependency cycles can't be scheduled. Try them one by one,
+    // they will wait for dependencies if the cycle can't be resolved.
+    for(SDK::Plugin* plugin: m_dependency_graph.cyclic())
     {
         if(plugin->isActive() && plugin->getState() == SDK::PLUGIN_STATE_NOT_INITIALIZED)
-        {
-            initializePlugin(plugin.data(), false);
-        }
+            initializePlugin(plugin);
     }
 
+    // Config items added by plugins during initialization
+    static_cast<ConfigImpl*>(SDK::Core::instance()->yasem_settings())->loadAddedItems();
+
     // Draw a table
-    DEBUG() << "Initialization finished";
+    PLUGINS_DEBUG() << "Initialization finished";
     LOG() << qPrintable(QString(66, '-'));
     LOG() << qPrintable(QString("|%1|%2|%3|%4|")
                           .arg(QString("PLUGIN").leftJustified(30))
@@ -372,22 +583,33 @@ SDK::PluginErrorCodes PluginManagerImpl::initPlugins()
                           .arg(QString("STATUS").leftJustified(16)));
     LOG() << qPrintable(QString(66, '-')) ;
 
-    for(const QSharedPointer<SDK::Plugin>& plugin: m_plugins)
+    for(const PluginMetadata* info: m_plugin_catalogue)
     {
-        LOG() << qPrintable(QString("|%1|%2|%3|%4|")
-                              .arg(plugin->getName().leftJustified(30))
-                              .arg(plugin->getVersion().toUpper().leftJustified(7))
-                              .arg(plugin->getRevision().toUpper().leftJustified(8))
-                              .arg(plugin->getStateDescription().toUpper().leftJustified(16))
-                              );
+        const QSharedPointer<SDK::Plugin>& plugin = info->plugin;
+        if(plugin)
+            LOG() << qPrintable(QString("|%1|%2|%3|%4|")
+                                  .arg(plugin->getName().leftJustified(30))
+                                  .arg(plugin->getVersion().toUpper().leftJustified(7))
+                                  .arg(plugin->getRevision().toUpper().leftJustified(8))
+                                  .arg(plugin->getStateDescription().toUpper().leftJustified(16))
+                                  );
+        else
+            LOG() << qPrintable(QString("|%1|%2|%3|%4|")
+                                  .arg(info->name.leftJustified(30))
+                                  .arg(info->version.toUpper().leftJustified(7))
+                                  .arg(info->revision.toUpper().leftJustified(8))
+                                  .arg(QString(isPluginEnabled(info) ? "NOT LOADED" : "DISABLED").leftJustified(16))
+                                  );
     }
     LOG() << qPrintable(QString(66, '-')) ;
+
+    StartupTracer::instance()->printSummary();
     return SDK::PLUGIN_ERROR_NO_ERROR;
 }
 
 SDK::PluginErrorCodes PluginManagerImpl::deinitPlugins()
 {
-    DEBUG() << "deinitPlugins()";
+    PLUGINS_DEBUG() << "deinitPlugins()";
     for(QSharedPointer<SDK::Plugin> plugin: m_plugins)
     {
         if(plugin->isActive() && plugin->getState() == SDK::PLUGIN_STATE_INITIALIZED)
@@ -427,11 +649,15 @@ void PluginManagerImpl::onPluginUnloaded()
 
 void PluginManagerImpl::onPluginInitialized()
 {
-    SDK::Plugin* pl = qobject_cast<SDK::Plugin*>(sender());
-    STUB() << pl->getName();
-    for(QSharedPointer<SDK::Plugin> plugin: m_plugins)
+    SDK::Plugin* plugin = qobject_cast<SDK::Plugin*>(sender());
+    STUB() << plugin->getName();
+
+    // Plugin has been initialized at runtime, so its dependents may continue now
+    if(m_init_scheduler_active) return;
+    for(SDK::Plugin* dependent: m_dependency_graph.dependents(plugin))
     {
-        initializePlugin(plugin.data());
+        if(dependent->getState() == SDK::PLUGIN_STATE_WAITING_FOR_DEPENDENCY)
+            initializePlugin(dependent);
     }
 }
 
@@ -439,108 +665,350 @@ void PluginManagerImpl::onPluginDeinitialized()
 {
     SDK::Plugin* plugin = qobject_cast<SDK::Plugin*>(sender());
     STUB() << plugin->getName();
-}
 
-//#define MULTITHREADED_PLUGINS
+    for(SDK::Plugin* dependent: m_dependency_graph.dependents(plugin))
+        deinitializePlugin(dependent);
+}
 
-SDK::PluginErrorCodes PluginManagerImpl::initializePlugin(SDK::Plugin *plugin, bool go_deeper, bool ignore_dependencies)
+void PluginManagerImpl::onPluginError()
 {
-    switch(plugin->getState())
+    SDK::Plugin* plugin = qobject_cast<SDK::Plugin*>(sender());
+    STUB() << plugin->getName();
+
+    for(SDK::Plugin* dependent: m_dependency_graph.dependents(plugin))
     {
-        case SDK::PLUGIN_STATE_INITIALIZED:      return SDK::PLUGIN_ERROR_NO_ERROR;
-        case SDK::PLUGIN_STATE_CONFLICT:         return SDK::PLUGIN_ERROR_CONFLICT;
-        case SDK::PLUGIN_STATE_DISABLED:         return SDK::PLUGIN_ERROR_PLUGIN_DISABLED;
-        case SDK::PLUGIN_STATE_ERROR_STATE:      return SDK::PLUGIN_ERROR_UNKNOWN_ERROR;
-        case SDK::PLUGIN_STATE_THREAD_CREATING:  return SDK::PLUGIN_ERROR_NO_ERROR;
-        case SDK::PLUGIN_STATE_THREAD_STARTED:   return SDK::PLUGIN_ERROR_NO_ERROR;
-        default: {
-            plugin->setState(SDK::PLUGIN_STATE_THREAD_CREATING);
+        for(const SDK::PluginDependency& dep: dependent->dependencies())
+        {
+            if(!plugin->has_role(dep.getRole())) continue;
+
+            if(dep.isRequired())
+                deinitializePlugin(dependent);
+            else if(dep.doSkipIfFailed())
+                initializePlugin(dependent);
+            break;
         }
     }
+}
 
-    SDK::ConfigItem* plugin_info = m_plugins_config->findItemByKey(plugin->getId());
-    if(!plugin_info->value().toBool())
-    {
-        DEBUG() << "Plugin" << plugin->getName() << "is disabled in config. Skipping.";
-        plugin->setState(SDK::PLUGIN_STATE_DISABLED);
-        return SDK::PLUGIN_ERROR_PLUGIN_DISABLED;
-    }
+/**
+ * @brief PluginManagerImpl::runInitializationSchedule
+ *
+ * Initializes plugins in topological order of the dependency graph.
+ * A plugin is started as soon as all its providers have finished. Multithreaded
+ * plugins are initialized in their own threads (@see startThreadedInitialization()),
+ * so they don't wait for each other. Other plugins are initialized in the main thread.
+ */
+void PluginManagerImpl::runInitializationSchedule()
+{
+    QHash<SDK::Plugin*, int> pending;
+    QList<SDK::Plugin*> ready;
+    QList<SDK::Plugin*> main_thread_queue;
+    int running = 0;
 
-    if(pluginHasConflicts(plugin))
-    {
-        plugin->setState(SDK::PLUGIN_STATE_CONFLICT);
-        return SDK::PLUGIN_ERROR_CONFLICT;
-    }
+    StartupTracer* tracer = StartupTracer::instance();
+    const qint64 schedule_start = tracer->now();
 
-    QList<SDK::PluginDependency> unresolved_dependencies = getUnresolvedDependencies(plugin);
-    if(unresolved_dependencies.isEmpty() || ignore_dependencies)
+    for(const QSharedPointer<SDK::Plugin>& plugin: m_plugins)
     {
-        LOG() << "Initializing plugin" << plugin->getName();
+        int count = m_dependency_graph.providers(plugin.data()).size();
+        pending.insert(plugin.data(), count);
+        if(count == 0)
+            ready.append(plugin.data());
+    }
 
-#ifdef MULTITHREADED_PLUGINS
-        if(plugin->isMultithreadingEnabled() && plugin->thread() == QThread::currentThread())
+    auto finish = [&](SDK::Plugin* plugin) {
+        for(SDK::Plugin* dependent: m_dependency_graph.dependents(plugin))
         {
-            PluginThread* thread = new PluginThread(plugin, QThread::currentThread());
-            plugin->moveToThread(thread);
-            thread->start();
-            DEBUG() << plugin->thread()->objectName();
+            if(--pending[dependent] == 0)
+            {
+                tracer->addEvent(TRACE_PLUGIN_WAIT, schedule_start, tracer->now(), dependent->getId());
+                ready.append(dependent);
+            }
         }
-        else
+    };
+
+    m_init_scheduler_active = true;
+    forever
+    {
+        while(!ready.isEmpty())
         {
-            PluginErrorCodes result = plugin->initialize();
+            SDK::Plugin* plugin = ready.takeFirst();
+            SDK::PluginErrorCodes result;
+            if(!plugin->isActive() || plugin->getState() != SDK::PLUGIN_STATE_NOT_INITIALIZED
+                    || !preparePluginInitialization(plugin, false, result))
+            {
+                finish(plugin);
+                continue;
+            }
 
-            if(result == PLUGIN_ERROR_NO_ERROR)
-                plugin->setState(PLUGIN_STATE_INITIALIZED);
+            if(canInitializeConcurrently(plugin))
+            {
+                startThreadedInitialization(plugin);
+                running++;
+            }
             else
-                plugin->setState(PLUGIN_STATE_ERROR_STATE);
+                main_thread_queue.append(plugin);
         }
-        return PLUGIN_ERROR_NO_ERROR;
-#else
-        SDK::PluginErrorCodes result = plugin->initialize();
 
-        if(result == SDK::PLUGIN_ERROR_NO_ERROR)
+        InitResult item;
+        if(running > 0 && takeConcurrentResult(item, main_thread_queue.isEmpty()))
         {
-            for(SDK::PluginRole role: plugin->roles().keys())
+            running--;
+            if(!isStaleResult(item))
+                completePluginInitialization(item.plugin, item.result);
+            finish(item.plugin);
+        }
+        else if(!main_thread_queue.isEmpty())
+        {
+            SDK::Plugin* plugin = main_thread_queue.takeFirst();
+            SDK::PluginErrorCodes result;
+            LOG() << "Initializing plugin" << plugin->getName();
             {
-                QList<SDK::AbstractPluginObject*> list = m_plugin_objects.value(role);
-                list.append(plugin->roles().value(role));
-                m_plugin_objects.insert(role, list);
+                StartupTraceScope trace(TRACE_PLUGIN_INIT, plugin->getId());
+                LogCategories::PluginScope log_scope(plugin->getId());
+                result = plugin->initialize();
             }
-            plugin->setState(SDK::PLUGIN_STATE_INITIALIZED);
+            completePluginInitialization(plugin, result);
+            finish(plugin);
         }
-        else
-            plugin->setState(SDK::PLUGIN_STATE_ERROR_STATE);
-        return result;
-#endif //MULTITHREADED_PLUGINS
+        else if(running == 0)
+            break;
     }
-    else if(go_deeper)
+    m_init_scheduler_active = false;
+}
+
+bool PluginManagerImpl::canInitializeConcurrently(SDK::Plugin *plugin)
+{
+    // Only top level objects can be moved between threads. Objects created by initialize()
+    // stay in the plugin's thread, so the plugin should be ready to live there.
+    if(!m_parallel_init || !plugin->isMultithreadingEnabled() || plugin->parent() != NULL) return false;
+
+    PluginMetadata* info = m_plugin_catalogue_index.value(plugin->getId());
+    if(info == NULL || (info->flags & SDK::PLUGIN_FLAG_GUI)) return false;
+
+    // Widgets and web views must be created in GUI thread
+    for(SDK::PluginRole role: plugin->roles().keys())
     {
-        for(QSharedPointer<SDK::Plugin> pl: m_plugins)
+        switch(role)
         {
-            if(pl == plugin) continue;
-            for(SDK::PluginDependency dep: unresolved_dependencies)
-            {
-                if(pl->has_role(dep.getRole()))
-                {
-                    for(SDK::PluginDependency dep2: pl->dependencies())
-                    {
-                        if(plugin->has_role(dep2.getRole()))
-                        {
-                            QString msg("Circular dependencies %1 <-> %2");
-                            WARN() << qPrintable(msg.arg(plugin->getName()) .arg(pl->getName()));
-                            //return initializePlugin(plugin, false, true);
-                        }
-                    }
-                }
-            }
+            case SDK::ROLE_GUI:
+            case SDK::ROLE_BROWSER:
+            case SDK::ROLE_MEDIA:
+            case SDK::ROLE_WEB_GUI:
+                return false;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief PluginManagerImpl::startThreadedInitialization
+ *
+ * Moves the plugin into its own event loop thread where it's initialized and
+ * stays until deinitialization. Used for plugins that support multithreading.
+ */
+void PluginManagerImpl::startThreadedInitialization(SDK::Plugin *plugin)
+{
+    LOG() << "Initializing plugin" << plugin->getName() << "in its own thread";
+
+    PluginThread* thread = new PluginThread(plugin, this);
+    const quint64 serial = ++m_init_serial;
+    m_init_serials.insert(plugin, serial);
+    m_threads_mutex.lock();
+    m_plugin_threads.insert(plugin, thread);
+    m_threads_mutex.unlock();
+
+    connect(thread, &PluginThread::initializationFinished, this, [=](int result) {
+        InitResult item;
+        item.plugin = plugin;
+        item.result = (SDK::PluginErrorCodes)result;
+        item.serial = serial;
+        pushConcurrentResult(item);
+    }, Qt::DirectConnection);
+
+    plugin->setState(SDK::PLUGIN_STATE_THREAD_STARTED);
+    plugin->moveToThread(thread);
+    thread->start();
+}
+
+void PluginManagerImpl::stopPluginThread(SDK::Plugin *plugin)
+{
+    // Result of initialization that hasn't been applied yet is stale now
+    m_init_serials.remove(plugin);
+
+    m_threads_mutex.lock();
+    PluginThread* thread = m_plugin_threads.take(plugin);
+    m_threads_mutex.unlock();
+    if(thread == NULL) return;
+
+    // Only the owning thread can give the plugin back to the main thread
+    QThread* main_thread = this->thread();
+    thread->proxy()->invoke([=]() {
+        plugin->moveToThread(main_thread);
+    });
+
+    thread->quit();
+    thread->wait();
+    delete thread;
+}
+
+void PluginManagerImpl::pushConcurrentResult(const InitResult &item)
+{
+    QMutexLocker locker(&m_init_mutex);
+    m_init_results.append(item);
+    m_init_condition.wakeAll();
+
+    // Initialization scheduler takes results itself, otherwise they're applied by the main thread's event loop
+    QMetaObject::invokeMethod(this, "processConcurrentResults", Qt::QueuedConnection);
+}
+
+void PluginManagerImpl::processConcurrentResults()
+{
+    if(m_init_scheduler_active) return;
+
+    InitResult item;
+    while(takeConcurrentResult(item, false))
+    {
+        if(!isStaleResult(item))
+            completePluginInitialization(item.plugin, item.result);
+    }
+}
+
+/**
+ * @brief PluginManagerImpl::isStaleResult
+ *
+ * Returns true if the plugin has been deinitialized (and maybe started again)
+ * since the initialization that produced the result.
+ */
+bool PluginManagerImpl::isStaleResult(const InitResult &item) const
+{
+    return m_init_serials.value(item.plugin) != item.serial
+            || item.plugin->getState() != SDK::PLUGIN_STATE_THREAD_STARTED;
+}
+
+/**
+ * @brief PluginManagerImpl::invoke
+ *
+ * Thread-safe way to call a plugin: the function is executed in the plugin's thread.
+ * Plugins without their own thread live in the main thread, so calls from other threads
+ * are posted to the main thread. The function is called directly only if the caller
+ * is already in the plugin's thread.
+ * Plugins can reach it through the meta-object system:
+ * QMetaObject::invokeMethod(manager, "invoke", Qt::DirectConnection,
+ *     Q_ARG(SDK::Plugin*, plugin), Q_ARG(PluginInvocation, func), Q_ARG(bool, true));
+ */
+void PluginManagerImpl::invoke(SDK::Plugin *plugin, PluginInvocation func, bool wait)
+{
+    m_threads_mutex.lock();
+    PluginThread* thread = m_plugin_threads.value(plugin);
+    m_threads_mutex.unlock();
+    if(thread != NULL)
+        thread->proxy()->invoke(func, wait);
+    else
+    {
+        Q_ASSERT(plugin->thread() == m_main_thread_proxy->thread());
+        const QString id = plugin->getId();
+        m_main_thread_proxy->invoke([=]() {
+            LogCategories::PluginScope log_scope(id);
+            func();
+        }, wait);
+    }
+}
+
+bool PluginManagerImpl::takeConcurrentResult(InitResult &item, bool wait)
+{
+    QMutexLocker locker(&m_init_mutex);
+    while(m_init_results.isEmpty())
+    {
+        if(!wait) return false;
+
+        // Events are not processed here: plugin threads must not block on
+        // the main thread during initialize()
+        m_init_condition.wait(&m_init_mutex);
+    }
+
+    item = m_init_results.takeFirst();
+    return true;
+}
+
+SDK::PluginErrorCodes PluginManagerImpl::initializePlugin(SDK::Plugin *plugin, bool ignore_dependencies)
+{
+    SDK::PluginErrorCodes result;
+    if(!preparePluginInitialization(plugin, ignore_dependencies, result))
+        return result;
+
+    if(canInitializeConcurrently(plugin))
+    {
+        startThreadedInitialization(plugin);
+        return SDK::PLUGIN_ERROR_NO_ERROR;
+    }
+
+    LOG() << "Initializing plugin" << plugin->getName();
+    {
+        StartupTraceScope trace(TRACE_PLUGIN_INIT, plugin->getId());
+        LogCategories::PluginScope log_scope(plugin->getId());
+        result = plugin->initialize();
+    }
+    completePluginInitialization(plugin, result);
+    return result;
+}
+
+/**
+ * @brief PluginManagerImpl::preparePluginInitialization
+ *
+ * Checks if the plugin can be initialized right now and updates its state otherwise.
+ * Returns false and sets result if the plugin shouldn't be initialized.
+ */
+bool PluginManagerImpl::preparePluginInitialization(SDK::Plugin *plugin, bool ignore_dependencies, SDK::PluginErrorCodes &result)
+{
+    switch(plugin->getState())
+    {
+        case SDK::PLUGIN_STATE_INITIALIZED:      result = SDK::PLUGIN_ERROR_NO_ERROR;          return false;
+        case SDK::PLUGIN_STATE_CONFLICT:         result = SDK::PLUGIN_ERROR_CONFLICT;          return false;
+        case SDK::PLUGIN_STATE_DISABLED:         result = SDK::PLUGIN_ERROR_PLUGIN_DISABLED;   return false;
+        case SDK::PLUGIN_STATE_ERROR_STATE:      result = SDK::PLUGIN_ERROR_UNKNOWN_ERROR;     return false;
+        case SDK::PLUGIN_STATE_THREAD_CREATING:  result = SDK::PLUGIN_ERROR_NO_ERROR;          return false;
+        case SDK::PLUGIN_STATE_THREAD_STARTED:   result = SDK::PLUGIN_ERROR_NO_ERROR;          return false;
+        default: {
+            plugin->setState(SDK::PLUGIN_STATE_THREAD_CREATING);
         }
     }
-    //else
-    //{
+
+    if(!isPluginEnabled(plugin->getId()))
+    {
+        PLUGINS_DEBUG() << "Plugin" << plugin->getName() << "is disabled in config. Skipping.";
+        plugin->setState(SDK::PLUGIN_STATE_DISABLED);
+        result = SDK::PLUGIN_ERROR_PLUGIN_DISABLED;
+        return false;
+    }
+
+    if(pluginHasConflicts(plugin))
+    {
+        plugin->setState(SDK::PLUGIN_STATE_CONFLICT);
+        result = SDK::PLUGIN_ERROR_CONFLICT;
+        return false;
+    }
+
+    if(!ignore_dependencies && !getUnresolvedDependencies(plugin).isEmpty())
+    {
         plugin->setState(SDK::PLUGIN_STATE_WAITING_FOR_DEPENDENCY);
-        //LOG() << "....Waiting for dependency(s) for " << plugin->getName() << getDependencyNames(unresolved_dependencies);
-        return SDK::PLUGIN_ERROR_DEPENDENCY_MISSING;
-    //}
+        result = SDK::PLUGIN_ERROR_DEPENDENCY_MISSING;
+        return false;
+    }
+
+    result = SDK::PLUGIN_ERROR_NO_ERROR;
+    return true;
+}
+
+void PluginManagerImpl::completePluginInitialization(SDK::Plugin *plugin, SDK::PluginErrorCodes result)
+{
+    if(result == SDK::PLUGIN_ERROR_NO_ERROR)
+        plugin->setState(SDK::PLUGIN_STATE_INITIALIZED);
+    else
+        plugin->setState(SDK::PLUGIN_STATE_ERROR_STATE);
+    updatePluginIndex(plugin);
 }
 
 SDK::PluginErrorCodes PluginManagerImpl::deinitializePlugin(SDK::Plugin *plugin)
@@ -548,11 +1016,17 @@ SDK::PluginErrorCodes PluginManagerImpl::deinitializePlugin(SDK::Plugin *plugin)
     if(plugin->getState() == SDK::PLUGIN_STATE_NOT_INITIALIZED) return SDK::PLUGIN_ERROR_NO_ERROR;
 
     LOG() << "Deinitialization of" << plugin->getName();
-    SDK::PluginErrorCodes result = plugin->deinitialize();
+    SDK::PluginErrorCodes result = SDK::PLUGIN_ERROR_NO_ERROR;
+    invoke(plugin, [&]() {
+        result = plugin->deinitialize();
+    });
+    stopPluginThread(plugin);
+
     if(result == SDK::PLUGIN_ERROR_NO_ERROR)
         plugin->setState(SDK::PLUGIN_STATE_NOT_INITIALIZED);
     else
         plugin->setState(SDK::PLUGIN_STATE_ERROR_STATE);
+    updatePluginIndex(plugin);
     return result;
 }
 
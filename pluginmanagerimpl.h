@@ -4,9 +4,20 @@
 #include "pluginmanager.h"
 #include "yasemsettings.h"
 #include "plugindependency.h"
+#include "pluginmetadata.h"
+#include "pluginmetadatacache.h"
+#include "plugindependencygraph.h"
+#include "pluginthread.h"
 
 #include <QObject>
 #include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QWaitCondition>
+
+#include <functional>
 
 namespace yasem {
 
@@ -30,16 +41,69 @@ public:
 
     SDK::PluginFlag parseFlags(const QString &flagsStr);
 
+    const QList<PluginMetadata*>& getPluginCatalogue() const;
+    const QVector<SDK::AbstractPluginObject*>& objectsByRole(SDK::PluginRole role) const;
+    const QList<QSharedPointer<SDK::Plugin>>& pluginsByRole(SDK::PluginRole role, bool active_only = true) const;
+
+    Q_INVOKABLE void invoke(SDK::Plugin* plugin, PluginInvocation func, bool wait = true);
+
     bool pluginHasConflicts(SDK::Plugin* plugin);
 
 
     // PluginManager interface
 protected:
     void registerPluginRole(const SDK::PluginRole &role, const SDK::PluginRoleData &data);
+    bool readPluginMetadata(const QString &fileName, PluginMetadata* info);
+    QSharedPointer<SDK::Plugin> instantiatePlugin(PluginMetadata* info);
+    void instantiateDisabledPlugins();
+    bool isPluginEnabled(const QString &id);
+    bool isPluginEnabled(const PluginMetadata *info);
+    void addToPluginIndex(const QSharedPointer<SDK::Plugin>& plugin);
+    void updatePluginIndex(SDK::Plugin* plugin);
+    bool preparePluginInitialization(SDK::Plugin* plugin, bool ignore_dependencies, SDK::PluginErrorCodes& result);
+    void completePluginInitialization(SDK::Plugin* plugin, SDK::PluginErrorCodes result);
+    void runInitializationSchedule();
+    bool canInitializeConcurrently(SDK::Plugin* plugin);
+    void startThreadedInitialization(SDK::Plugin* plugin);
+    void stopPluginThread(SDK::Plugin* plugin);
+    struct InitResult
+    {
+        SDK::Plugin* plugin;
+        SDK::PluginErrorCodes result;
+        quint64 serial;
+    };
+
+    void pushConcurrentResult(const InitResult& item);
+    bool takeConcurrentResult(InitResult& item, bool wait);
+    bool isStaleResult(const InitResult& item) const;
 
     SDK::ConfigContainer* m_plugins_config;
+    QList<PluginMetadata*> m_plugin_catalogue;
+    QHash<QString, PluginMetadata*> m_plugin_catalogue_index;
+    PluginMetadataCache* m_metadata_cache;
+    PluginDependencyGraph m_dependency_graph;
+    bool m_parallel_init;
+    bool m_init_scheduler_active;
+
+    QMutex m_init_mutex;
+    QWaitCondition m_init_condition;
+    QList<InitResult> m_init_results;
+    // Serial of the running threaded initialization, results with other serials are stale
+    QHash<SDK::Plugin*, quint64> m_init_serials;
+    quint64 m_init_serial;
+    QMutex m_threads_mutex;
+    QHash<SDK::Plugin*, PluginThread*> m_plugin_threads;
+    // Runs calls to plugins that live in the main thread
+    PluginInvocationProxy* m_main_thread_proxy;
+
+    // Guards plugin list and role/IID indices. They're changed by the main thread only,
+    // so the main thread reads them without locking.
+    mutable QReadWriteLock m_registry_lock;
     QList<QSharedPointer<SDK::Plugin>> m_plugins;
-    QHash<SDK::PluginRole, QList<SDK::AbstractPluginObject*>> m_plugin_objects;
+    QHash<SDK::PluginRole, QVector<SDK::AbstractPluginObject*>> m_role_objects;
+    QHash<SDK::PluginRole, QList<QSharedPointer<SDK::Plugin>>> m_role_plugins;
+    QHash<SDK::PluginRole, QList<QSharedPointer<SDK::Plugin>>> m_active_role_plugins;
+    QHash<QString, QSharedPointer<SDK::Plugin>> m_iid_index;
     QString m_plugin_dir;
     QHash<SDK::PluginRole, SDK::PluginRoleData> m_plugin_roles;
 
@@ -48,8 +112,10 @@ protected slots:
     void onPluginUnloaded();
     void onPluginInitialized();
     void onPluginDeinitialized();
+    void onPluginError();
+    void processConcurrentResults();
 
-    SDK::PluginErrorCodes initializePlugin(SDK::Plugin* plugin, bool go_deeper = true, bool ignore_dependencies = false);
+    SDK::PluginErrorCodes initializePlugin(SDK::Plugin* plugin, bool ignore_dependencies = false);
     SDK::PluginErrorCodes deinitializePlugin(SDK::Plugin* plugin);
     QList<SDK::PluginDependency> getUnresolvedDependencies(SDK::Plugin* plugin);
     QStringList getDependencyNames(QList<SDK::PluginDependency> list);
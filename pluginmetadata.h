@@ -0,0 +1,54 @@
+#ifndef PLUGINMETADATA_H
+#define PLUGINMETADATA_H
+
+#include "plugin.h"
+#include "configkey.h"
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QJsonObject>
+#include <QSharedPointer>
+
+class QPluginLoader;
+
+namespace yasem {
+
+/**
+ * @brief Catalogue entry of a plugin file.
+ *
+ * Everything here is read from the metadata embedded into the plugin file,
+ * so the library itself is not loaded until the plugin is selected for
+ * initialization (@see PluginManagerImpl::instantiatePlugin()).
+ */
+class PluginMetadata
+{
+public:
+    PluginMetadata():
+        flags(SDK::PLUGIN_FLAG_NONE),
+        enabled(NULL),
+        loader(NULL)
+    {}
+
+    QString file_name;
+    QString iid;
+    QString class_name;
+    QJsonObject metadata;
+
+    QString id;
+    QString name;
+    QString version;
+    QString revision;
+    SDK::PluginFlag flags;
+
+    // Value of the plugin's item in the plugins config group
+    const ConfigSlot<bool>* enabled;
+
+    // Runtime part, empty until the plugin is instantiated
+    QPluginLoader* loader;
+    QSharedPointer<SDK::Plugin> plugin;
+};
+
+}
+
+#endif // PLUGINMETADATA_H
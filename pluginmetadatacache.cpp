@@ -0,0 +1,251 @@
+#include "pluginmetadatacache.h"
+#include "macros.h"
+#include "logcategories.h"
+
+#include <QDataStream>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QJsonDocument>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+using namespace yasem;
+
+static const quint32 PLUGIN_CACHE_MAGIC     = 0x59504d43; // YPMC
+static const quint32 PLUGIN_CACHE_VERSION   = 2;
+
+PluginMetadataCache::PluginMetadataCache(const QString &fileName):
+    m_file(fileName),
+    m_data(NULL),
+    m_size(0),
+    m_changed(false)
+{
+
+}
+
+PluginMetadataCache::~PluginMetadataCache()
+{
+    close();
+}
+
+/**
+ * @brief PluginMetadataCache::open
+ *
+ * Maps cache file into memory and builds an index of its records.
+ * Returns false if there is no valid cache, in this case all plugins
+ * will be scanned and the cache will be created on save().
+ */
+bool PluginMetadataCache::open()
+{
+    close();
+
+    if(!m_file.exists())
+    {
+        PLUGINS_DEBUG() << "Plugin cache" << m_file.fileName() << "doesn't exist";
+        return false;
+    }
+
+    if(!m_file.open(QFile::ReadOnly))
+    {
+        WARN() << "Cannot open plugin cache" << m_file.fileName();
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_data = m_file.map(0, m_size);
+    if(m_data == NULL)
+    {
+        WARN() << "Cannot map plugin cache" << m_file.fileName() << m_file.errorString();
+        close();
+        return false;
+    }
+
+    QDataStream stream(QByteArray::fromRawData((const char*)m_data, m_size));
+    quint32 magic, version, count;
+    stream >> magic >> version >> count;
+    if(stream.status() != QDataStream::Ok || magic != PLUGIN_CACHE_MAGIC || version != PLUGIN_CACHE_VERSION)
+    {
+        WARN() << "Plugin cache" << m_file.fileName() << "is invalid or outdated";
+        close();
+        return false;
+    }
+
+    for(quint32 index = 0; index < count; index++)
+    {
+        quint32 length;
+        stream >> length;
+        qint64 offset = stream.device()->pos();
+        if(stream.status() != QDataStream::Ok || offset + length > m_size)
+        {
+            WARN() << "Plugin cache" << m_file.fileName() << "is truncated";
+            m_records.clear();
+            break;
+        }
+
+        QByteArray record = QByteArray::fromRawData((const char*)m_data + offset, length);
+        QDataStream record_stream(record);
+        QString path;
+        record_stream >> path;
+        m_records.insert(path, record);
+
+        stream.skipRawData(length);
+    }
+
+    PLUGINS_DEBUG() << "Plugin cache loaded," << m_records.size() << "entries";
+    return !m_records.isEmpty();
+}
+
+/**
+ * @brief PluginMetadataCache::lookup
+ *
+ * Fills info from the cache if the plugin file hasn't been changed since it was cached.
+ */
+bool PluginMetadataCache::lookup(const QString &pluginFile, PluginMetadata *info)
+{
+    if(!m_records.contains(pluginFile)) return false;
+
+    const QByteArray& record = m_records[pluginFile];
+
+    FileStamp actual;
+    if(!readFileStamp(pluginFile, actual)) return false;
+
+    QDataStream stream(record);
+    QString path;
+    FileStamp cached;
+    stream >> path >> cached.size >> cached.mtime >> cached.inode;
+
+    if(cached.size != actual.size || cached.mtime != actual.mtime || cached.inode != actual.inode)
+    {
+        PLUGINS_DEBUG() << "Plugin" << pluginFile << "has been changed since it was cached";
+        return false;
+    }
+
+    if(!deserialize(record, info))
+    {
+        *info = PluginMetadata();
+        return false;
+    }
+
+    m_actual.insert(pluginFile, record);
+    return true;
+}
+
+void PluginMetadataCache::update(const PluginMetadata *info)
+{
+    FileStamp stamp;
+    if(!readFileStamp(info->file_name, stamp)) return;
+
+    m_actual.insert(info->file_name, serialize(info, stamp));
+    m_changed = true;
+}
+
+/**
+ * @brief PluginMetadataCache::save
+ *
+ * Writes the cache back if any plugin has been added, changed or removed.
+ * Records of unchanged plugins are copied from the mapped file as is.
+ */
+bool PluginMetadataCache::save()
+{
+    if(!m_changed && m_actual.size() == m_records.size())
+    {
+        close();
+        return true;
+    }
+
+    PLUGINS_DEBUG() << "Updating plugin cache" << m_file.fileName();
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << PLUGIN_CACHE_MAGIC << PLUGIN_CACHE_VERSION << (quint32)m_actual.size();
+    for(const QByteArray& record: m_actual)
+    {
+        stream << (quint32)record.size();
+        stream.writeRawData(record.constData(), record.size());
+    }
+
+    // Records may point to the mapped memory, so unmap only after they were copied
+    close();
+
+    QSaveFile file(m_file.fileName());
+    if(!file.open(QFile::WriteOnly))
+    {
+        WARN() << "Cannot write plugin cache" << file.fileName() << file.errorString();
+        return false;
+    }
+    file.write(data);
+    return file.commit();
+}
+
+void PluginMetadataCache::close()
+{
+    m_actual.clear();
+    m_records.clear();
+    m_changed = false;
+
+    if(m_data != NULL)
+    {
+        m_file.unmap(m_data);
+        m_data = NULL;
+    }
+    m_size = 0;
+    if(m_file.isOpen())
+        m_file.close();
+}
+
+bool PluginMetadataCache::readFileStamp(const QString &fileName, FileStamp &stamp)
+{
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if(::stat(QFile::encodeName(fileName).constData(), &st) != 0)
+        return false;
+    stamp.size = st.st_size;
+#ifdef Q_OS_LINUX
+    stamp.mtime = (qint64)st.st_mtime * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    stamp.mtime = (qint64)st.st_mtime * 1000000000;
+#endif
+    stamp.inode = st.st_ino;
+#else
+    QFileInfo info(fileName);
+    if(!info.exists())
+        return false;
+    stamp.size = info.size();
+    stamp.mtime = info.lastModified().toMSecsSinceEpoch();
+    stamp.inode = 0;
+#endif
+    return true;
+}
+
+QByteArray PluginMetadataCache::serialize(const PluginMetadata *info, const FileStamp& stamp) const
+{
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream << info->file_name << stamp.size << stamp.mtime << stamp.inode;
+    stream << info->iid << info->class_name
+           << QJsonDocument(info->metadata).toJson(QJsonDocument::Compact)
+           << info->id << info->name << info->version << info->revision
+           << (qint32)info->flags;
+
+    return record;
+}
+
+bool PluginMetadataCache::deserialize(const QByteArray &record, PluginMetadata *info) const
+{
+    QDataStream stream(record);
+    FileStamp stamp;
+    QByteArray metadata;
+    qint32 flags;
+
+    stream >> info->file_name >> stamp.size >> stamp.mtime >> stamp.inode;
+    stream >> info->iid >> info->class_name >> metadata
+           >> info->id >> info->name >> info->version >> info->revision
+           >> flags;
+    info->flags = (SDK::PluginFlag)flags;
+    info->metadata = QJsonDocument::fromJson(metadata).object();
+
+    return stream.status() == QDataStream::Ok;
+}
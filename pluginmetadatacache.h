@@ -0,0 +1,63 @@
+#ifndef PLUGINMETADATACACHE_H
+#define PLUGINMETADATACACHE_H
+
+#include "pluginmetadata.h"
+
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QByteArray>
+#include <QFile>
+
+namespace yasem {
+
+/**
+ * @brief On-disk cache of plugin metadata.
+ *
+ * Keeps parsed metadata of every plugin file together with file's size,
+ * modification time and inode, so unchanged plugins don't need to be
+ * scanned on the next start. Cache file is mapped into memory and only
+ * entries of changed files are serialized again on save().
+ *
+ * File layout (QDataStream, big endian):
+ *   quint32 magic, quint32 version, quint32 count,
+ *   count * { quint32 length, <length bytes of entry> }
+ */
+class PluginMetadataCache
+{
+public:
+    explicit PluginMetadataCache(const QString &fileName);
+    virtual ~PluginMetadataCache();
+
+    bool open();
+    bool lookup(const QString &pluginFile, PluginMetadata* info);
+    void update(const PluginMetadata* info);
+    bool save();
+
+protected:
+    struct FileStamp
+    {
+        quint64 size;
+        qint64 mtime;
+        quint64 inode;
+    };
+
+    static bool readFileStamp(const QString &fileName, FileStamp& stamp);
+    QByteArray serialize(const PluginMetadata* info, const FileStamp& stamp) const;
+    bool deserialize(const QByteArray& record, PluginMetadata* info) const;
+    void close();
+
+    QFile m_file;
+    uchar* m_data;
+    qint64 m_size;
+    bool m_changed;
+
+    // Raw records of the mapped file keyed by plugin file path. Data is not copied.
+    QHash<QString, QByteArray> m_records;
+    // Entries that will be written on save(): either raw records from mapped file or updated ones
+    QHash<QString, QByteArray> m_actual;
+};
+
+}
+
+#endif // PLUGINMETADATACACHE_H
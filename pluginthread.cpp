@@ -1,25 +1,53 @@
 #include "pluginthread.h"
 #include "plugin.h"
+#include "startuptracer.h"
+#include "crashrecorder.h"
+#include "cpuprofiler.h"
+#include "logcategories.h"
 
 using namespace yasem;
 
 PluginThread::PluginThread(SDK::Plugin* plugin, QObject *parent) :
-    QThread(parent)
+    QThread(parent),
+    m_proxy(new PluginInvocationProxy())
 {
     this->m_plugin = plugin;
     plugin->setParent(0);
 
     setObjectName(QString("Thread of %1").arg(plugin->getName()));
+
+    m_proxy->moveToThread(this);
+    connect(this, &QThread::finished, m_proxy, &QObject::deleteLater);
+}
+
+PluginThread::~PluginThread()
+{
+
+}
+
+SDK::Plugin* PluginThread::plugin() const
+{
+    return m_plugin;
+}
+
+PluginInvocationProxy* PluginThread::proxy() const
+{
+    return m_proxy;
 }
 
 void PluginThread::run()
 {
-    m_plugin->setState(SDK::PLUGIN_STATE_THREAD_STARTED);
-    SDK::PluginErrorCodes result = m_plugin->initialize();
+    CrashRecorder::installThread();
+    CpuProfiler::instance()->registerThread(objectName());
+    // Everything that's logged by the thread belongs to the plugin
+    LogCategories::PluginScope log_scope(m_plugin->getId());
 
-    if(result == SDK::PLUGIN_ERROR_NO_ERROR)
-        m_plugin->setState(SDK::PLUGIN_STATE_INITIALIZED);
-    else
-        m_plugin->setState(SDK::PLUGIN_STATE_ERROR_STATE);
+    SDK::PluginErrorCodes result;
+    {
+        StartupTraceScope trace(TRACE_PLUGIN_INIT, m_plugin->getId());
+        result = m_plugin->initialize();
+    }
+    emit initializationFinished(result);
     exec();
+    CpuProfiler::instance()->unregisterThread();
 }
@@ -1,6 +1,8 @@
 #ifndef PLUGINTHREAD_H
 #define PLUGINTHREAD_H
 
+#include "plugininvocationproxy.h"
+
 #include <QThread>
 
 namespace yasem {
@@ -8,19 +10,34 @@ namespace SDK {
 class Plugin;
 }
 
+/**
+ * @brief Event loop thread that hosts a plugin.
+ *
+ * Plugin is initialized in the thread and lives there until it's deinitialized.
+ * The thread never changes plugin's state itself: results are reported
+ * with initializationFinished() and PluginManager applies them.
+ */
 class PluginThread : public QThread
 {
     Q_OBJECT
 public:
     explicit PluginThread(SDK::Plugin* m_plugin, QObject *parent = 0);
+    virtual ~PluginThread();
+
+    SDK::Plugin* plugin() const;
+    PluginInvocationProxy* proxy() const;
 
 signals:
+    // Emitted from the plugin thread
+    void initializationFinished(int result);
+
 public slots:
 
 
     // QThread interface
 protected:
     SDK::Plugin* m_plugin;
+    PluginInvocationProxy* m_proxy;
     void run();
 };
 
@@ -1,6 +1,7 @@
 #include "profileconfigparserimpl.h"
 
 #include "macros.h"
+#include "logcategories.h"
 
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -10,13 +11,13 @@ using namespace yasem;
 
 ProfileConfigParserImpl::ProfileConfigParserImpl()
 {
-    DEBUG() << "Profile paser initialized";
+    PROFILES_DEBUG() << "Profile paser initialized";
 }
 
 
 SDK::ProfileConfiguration ProfileConfigParserImpl::parseOptions(SDK::ProfileConfiguration &config, const QByteArray &data)
 {
-    DEBUG() << data;
+    PROFILES_DEBUG() << data;
 
     QJsonParseError *error = NULL;
     QJsonDocument doc = QJsonDocument::fromJson(data, error);
@@ -9,10 +9,12 @@
 #include "webpage.h"
 #include "networkstatistics.h"
 #include "datasource.h"
+#include "logcategories.h"
 
 #include <QFile>
 #include <QDir>
 #include <QRegularExpression>
+#include <QSettings>
 
 using namespace yasem;
 
@@ -64,6 +66,8 @@ void ProfileManageImpl::setActiveProfile(SDK::Profile* profile)
         if(item == profile)
         {
             m_active_profile = profile;
+            // Plugins read it from Core::settings(), so it's set there. QSettings writes it
+            // on its own sync from the event loop, not while profiles are being switched.
             SDK::Core::instance()->settings()->setValue("active_profile", profile->getId());
 
             qDebug() << QString("Active profile: %1").arg(profile->getName());
@@ -102,7 +106,7 @@ void ProfileManageImpl::setActiveProfile(SDK::Profile* profile)
     qWarning() << QString("Cannot change profile '%1': not found!").arg(profile->getId());
 }
 
-void ProfileManageImpl::loadDefaultKeymapFileIfNotExists(QSettings& keymap, const QString &classId, bool force_overwrite)
+void ProfileManageImpl::loadDefaultKeymapFileIfNotExists(IniFile& keymap, const QString &classId, bool force_overwrite)
 {
     QFile file(keymap.fileName());
     if(!file.exists() || force_overwrite)
@@ -112,10 +116,10 @@ void ProfileManageImpl::loadDefaultKeymapFileIfNotExists(QSettings& keymap, cons
 
         if(!dir.exists())
         {
-            DEBUG() << "Creating directory" << dir.absolutePath();
+            PROFILES_DEBUG() << "Creating directory" << dir.absolutePath();
             if(dir.mkpath(dir.absolutePath()))
             {
-                DEBUG() << "Directory created";
+                PROFILES_DEBUG() << "Directory created";
             }
             else
             {
@@ -130,7 +134,7 @@ void ProfileManageImpl::loadDefaultKeymapFileIfNotExists(QSettings& keymap, cons
             return;
         }
 
-        DEBUG() << "keymap file" << keymap.fileName() << "doesn't exists. Copying from resourses";
+        PROFILES_DEBUG() << "keymap file" << keymap.fileName() << "doesn't exists. Copying from resourses";
 
         QString defaultKeymapName = QString(":/defaults/keymaps/%1/default.ini").arg(classId);
         QFile res(defaultKeymapName);
@@ -160,19 +164,22 @@ void ProfileManageImpl::loadDefaultKeymapFileIfNotExists(QSettings& keymap, cons
 
 void ProfileManageImpl::loadProfileKeymap(SDK::Profile* profile)
 {
-    DEBUG() << "Loading keymap for profile" << profile->getName();
+    PROFILES_DEBUG() << "Loading keymap for profile" << profile->getName();
     QString classId = profile->getProfilePlugin()->getProfileClassId();
 
-    QSettings keymap(SDK::Core::instance()->getConfigDir().append("keymaps/%1/default.ini").arg(classId), QSettings::IniFormat, this);
+    IniFile keymap(SDK::Core::instance()->getConfigDir().append("keymaps/%1/default.ini").arg(classId));
 
     loadDefaultKeymapFileIfNotExists(keymap, classId, true);
 
-    keymap.sync();
+    if(!keymap.open())
+    {
+        ERROR() << "Cannot read keymap file" << keymap.fileName();
+        return;
+    }
 
     SDK::GUI* gui = SDK::GUI::instance();
 
-    keymap.beginGroup("keymap");
-    QStringList keys = keymap.allKeys();
+    QStringList keys = keymap.keys("keymap");
 
     SDK::Browser* browser = SDK::Browser::instance();
     if(browser)
@@ -180,7 +187,7 @@ void ProfileManageImpl::loadProfileKeymap(SDK::Profile* profile)
 
     for(QString key: keys)
     {
-        QString value = keymap.value(key).toString();
+        QString value = keymap.value(QString("keymap/").append(key)).toString();
         QStringList data = value.split("|");
 
         int code = -1;
@@ -227,9 +234,8 @@ void ProfileManageImpl::loadProfileKeymap(SDK::Profile* profile)
             if(browser) browser->registerKeyEvent(keycode_value, code, which, alt, ctrl, shift);
 
     }
-    keymap.endGroup();
 
-    DEBUG() << "Keymap loaded";
+    PROFILES_DEBUG() << "Keymap loaded";
 }
 
 bool ProfileManageImpl::removeProfile(SDK::Profile* profile)
@@ -238,7 +244,7 @@ bool ProfileManageImpl::removeProfile(SDK::Profile* profile)
         return false;
 
     QFile file(profilesDir.path().append("/").append(profile->getId()).append(".ini"));
-    DEBUG() << "Removing profile file" << file.fileName();
+    PROFILES_DEBUG() << "Removing profile file" << file.fileName();
     bool is_removed = file.remove();
     emit profileRemoved(is_removed);
     return is_removed && m_profiles_list.remove(profile);
@@ -255,9 +261,9 @@ void ProfileManageImpl::loadProfiles()
 
     if(!configDir.exists())
     {
-        DEBUG() << "Profiles directory doesn't exist. Creating" << full_profile_path;
+        PROFILES_DEBUG() << "Profiles directory doesn't exist. Creating" << full_profile_path;
         bool is_created = configDir.mkpath(full_profile_path);
-        DEBUG() << "Directory create result" << is_created;
+        PROFILES_DEBUG() << "Directory create result" << is_created;
     }
 
     qDebug() << "Looking for profiles in" << full_profile_path;
@@ -267,17 +273,21 @@ void ProfileManageImpl::loadProfiles()
         return;
     }
 
-    DEBUG() << "Searching for profiles in" << profilesDir.path();
+    PROFILES_DEBUG() << "Searching for profiles in" << profilesDir.path();
 
     profilesDir.setNameFilters(QStringList() << "*.ini");
 
     foreach (QString fileName, profilesDir.entryList(QDir::Files | QDir::NoSymLinks | QDir::Readable))
     {
-        DEBUG() << "Loading profile from" << fileName;
-        QSettings s(profilesDir.path().append("/").append(fileName), QSettings::IniFormat);
+        PROFILES_DEBUG() << "Loading profile from" << fileName;
+        IniFile s(profilesDir.path().append("/").append(fileName));
+        if(!s.open())
+        {
+            WARN() << "Cannot read profile file" << fileName;
+            continue;
+        }
 
-        s.beginGroup("profile");
-        QString classId = s.value("classid").toString();
+        QString classId = s.value("profile/classid").toString();
         SDK::StbPluginObject* stbPlugin = ProfileManager::instance()->getProfilePluginByClassId(classId);
 
         if(stbPlugin == NULL)
@@ -286,13 +296,11 @@ void ProfileManageImpl::loadProfiles()
             continue;
         }
 
-        SDK::Profile* profile = stbPlugin->createProfile(s.value("uuid").toString());
+        SDK::Profile* profile = stbPlugin->createProfile(s.value("profile/uuid").toString());
         Q_ASSERT(profile);
-        profile->setName(s.value("name").toString());
-        profile->setSubmodel(stbPlugin->getSubmodels().at(s.value("submodel").toInt()));
-        DEBUG() << "Profile" << profile->getName() << "loaded";
-
-        s.endGroup();
+        profile->setName(s.value("profile/name").toString());
+        profile->setSubmodel(stbPlugin->getSubmodels().at(s.value("profile/submodel").toInt()));
+        PROFILES_DEBUG() << "Profile" << profile->getName() << "loaded";
 
         m_profiles_list.insert(profile);
     }
@@ -300,7 +308,7 @@ void ProfileManageImpl::loadProfiles()
 
 SDK::Profile* ProfileManageImpl::createProfile(const QString &classId, const QString &submodel, const QString &baseName = "", bool overwrite = false)
 {
-    DEBUG() << "Creaing profile" << classId << baseName << submodel << baseName;
+    PROFILES_DEBUG() << "Creaing profile" << classId << baseName << submodel << baseName;
 
     SDK::StbPluginObject* stbPlugin = getProfilePluginByClassId(classId);
     SDK::Profile* profile(stbPlugin->createProfile());
@@ -348,7 +356,7 @@ SDK::Profile* ProfileManageImpl::findById(const QString &id)
     foreach (SDK::Profile* profile, m_profiles_list) {
         if(id == profile->getId())
         {
-            DEBUG() << "PROFILE: " << profile;
+            PROFILES_DEBUG() << "PROFILE: " << profile;
             return profile;
         }
     }
@@ -362,7 +370,7 @@ SDK::Profile* ProfileManageImpl::findByName(const QString &id)
     foreach (SDK::Profile* profile, m_profiles_list) {
         if(id == profile->getName())
         {
-            DEBUG() << "PROFILE: " << profile;
+            PROFILES_DEBUG() << "PROFILE: " << profile;
             return profile;
         }
     }
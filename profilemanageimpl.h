@@ -2,12 +2,12 @@
 #define PROFILEMANAGEIMPL_H
 
 #include "profilemanager.h"
+#include "inifile.h"
 
 #include <QObject>
 #include <QHash>
 #include <QFile>
 #include <QDir>
-#include <QSettings>
 
 namespace yasem
 {
@@ -44,7 +44,7 @@ protected:
     QDir profilesDir;
     QString createUniqueName(const QString &classId, const QString &baseName, bool overwrite);
 
-    void loadDefaultKeymapFileIfNotExists(QSettings& keymap, const QString &classId, bool force_overwrite = false);
+    void loadDefaultKeymapFileIfNotExists(IniFile& keymap, const QString &classId, bool force_overwrite = false);
 
     // ProfileManager interface
 public:
@@ -0,0 +1,182 @@
+#include "rotatinglogfile.h"
+
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QRegularExpression>
+#include <QtConcurrent>
+
+using namespace yasem;
+
+static const char* const LOG_SEGMENT_SUFFIX = ".qz";
+static const char* const LOG_SEGMENT_TIME_FORMAT = "yyyyMMdd-hhmmss-zzz";
+static const int LOG_COMPRESSION_LEVEL = 9;
+
+RotatingLogFile::RotatingLogFile(const QString &file_name, qint64 max_size, qint64 max_age, int keep):
+    m_file(file_name),
+    m_max_size(max_size),
+    m_max_age(max_age),
+    m_keep(keep),
+    m_size(0)
+{
+    // Segments are compressed one by one, so they never race for the same file
+    m_compressor.setMaxThreadCount(1);
+}
+
+RotatingLogFile::~RotatingLogFile()
+{
+    m_compressor.waitForDone();
+}
+
+bool RotatingLogFile::open()
+{
+    QMutexLocker locker(&m_mutex);
+    if(!openSegment())
+        return false;
+
+    // Segments that haven't been compressed before the last exit
+    QtConcurrent::run(&m_compressor, this, &RotatingLogFile::processRotatedSegments);
+    return true;
+}
+
+bool RotatingLogFile::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QString RotatingLogFile::fileName() const
+{
+    return m_file.fileName();
+}
+
+QMutex* RotatingLogFile::mutex()
+{
+    return &m_mutex;
+}
+
+QFile* RotatingLogFile::file()
+{
+    return &m_file;
+}
+
+int RotatingLogFile::handle() const
+{
+    return m_file.handle();
+}
+
+/**
+ * @brief RotatingLogFile::written
+ *
+ * Should be called after each write with the mutex locked.
+ * Rotates the segment if it has reached the limits.
+ */
+void RotatingLogFile::written(qint64 bytes)
+{
+    m_size += bytes;
+
+    const bool too_large = m_max_size > 0 && m_size >= m_max_size;
+    const bool too_old = m_max_age > 0 && m_opened.secsTo(QDateTime::currentDateTime()) >= m_max_age;
+    if(too_large || too_old)
+        rotate();
+}
+
+/**
+ * @brief RotatingLogFile::readSegment
+ *
+ * Returns the text of a compressed or plain log segment.
+ */
+QByteArray RotatingLogFile::readSegment(const QString &file_name)
+{
+    QFile file(file_name);
+    if(!file.open(QFile::ReadOnly))
+        return QByteArray();
+
+    const QByteArray data = file.readAll();
+    return file_name.endsWith(LOG_SEGMENT_SUFFIX) ? qUncompress(data) : data;
+}
+
+bool RotatingLogFile::openSegment()
+{
+    if(!m_file.open(QFile::WriteOnly | QFile::Append | QIODevice::Text | QIODevice::Unbuffered))
+        return false;
+
+    m_size = m_file.size();
+
+    // The file may be left from the previous run, so its age is taken from the file system.
+    // Birth time isn't supported everywhere, modification time of a non-empty file is the next best.
+    const QFileInfo info(m_file.fileName());
+#if QT_VERSION >= 0x050A00
+    m_opened = info.birthTime();
+#else
+    m_opened = info.created();
+#endif
+    if(!m_opened.isValid() || m_opened > QDateTime::currentDateTime())
+        m_opened = m_size > 0 ? info.lastModified() : QDateTime::currentDateTime();
+    return true;
+}
+
+void RotatingLogFile::rotate()
+{
+    const QString segment = QString("%1.%2").arg(m_file.fileName()).arg(QDateTime::currentDateTime().toString(LOG_SEGMENT_TIME_FORMAT));
+
+    m_file.close();
+    if(!QFile::rename(m_file.fileName(), segment))
+    {
+        // Keep writing into the same file rather than lose messages
+        openSegment();
+        return;
+    }
+
+    openSegment();
+    QtConcurrent::run(&m_compressor, this, &RotatingLogFile::processRotatedSegments);
+}
+
+/**
+ * @brief RotatingLogFile::processRotatedSegments
+ *
+ * Compresses rotated segments and removes the oldest ones. Runs in the compressor thread.
+ */
+void RotatingLogFile::processRotatedSegments() const
+{
+    const QFileInfo info(m_file.fileName());
+    QDir dir = info.absoluteDir();
+    const QString prefix = info.fileName() + ".";
+
+    // Only names made by rotate(), other files may share the prefix
+    const QRegularExpression segment_name(QString("^%1\\d{8}-\\d{6}-\\d{3}(%2)?$")
+                                          .arg(QRegularExpression::escape(prefix))
+                                          .arg(QRegularExpression::escape(LOG_SEGMENT_SUFFIX)));
+
+    QStringList compressed;
+    for(const QString& name: dir.entryList(QStringList() << prefix + "*", QDir::Files, QDir::Name))
+    {
+        if(!segment_name.match(name).hasMatch())
+            continue;
+
+        if(name.endsWith(LOG_SEGMENT_SUFFIX))
+        {
+            compressed.append(name);
+            continue;
+        }
+
+        QFile segment(dir.absoluteFilePath(name));
+        if(!segment.open(QFile::ReadOnly))
+            continue;
+
+        QSaveFile target(segment.fileName() + LOG_SEGMENT_SUFFIX);
+        if(!target.open(QFile::WriteOnly))
+            continue;
+
+        target.write(qCompress(segment.readAll(), LOG_COMPRESSION_LEVEL));
+        if(target.commit())
+        {
+            segment.remove();
+            compressed.append(name + LOG_SEGMENT_SUFFIX);
+        }
+    }
+
+    // Names end with the rotation time, so the oldest segments go first
+    compressed.sort();
+    while(m_keep >= 0 && compressed.size() > m_keep)
+        dir.remove(compressed.takeFirst());
+}
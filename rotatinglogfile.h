@@ -0,0 +1,55 @@
+#ifndef ROTATINGLOGFILE_H
+#define ROTATINGLOGFILE_H
+
+#include <QFile>
+#include <QMutex>
+#include <QDateTime>
+#include <QThreadPool>
+
+namespace yasem {
+
+/**
+ * @brief Text log file that is rotated by size and age.
+ *
+ * When the active segment becomes too large or too old it's renamed to
+ * <file name>.<yyyyMMdd-hhmmss-zzz> and a new segment is started. Rotated
+ * segments are compressed with qCompress() into *.qz files in a background
+ * thread and only the newest ones are kept.
+ *
+ * Writers must hold mutex() while they use handle() and report written().
+ */
+class RotatingLogFile
+{
+public:
+    RotatingLogFile(const QString &file_name, qint64 max_size, qint64 max_age, int keep);
+    ~RotatingLogFile();
+
+    bool open();
+    bool isOpen() const;
+    QString fileName() const;
+
+    QMutex* mutex();
+    QFile* file();
+    int handle() const;
+    void written(qint64 bytes);
+
+    static QByteArray readSegment(const QString &file_name);
+
+protected:
+    bool openSegment();
+    void rotate();
+    void processRotatedSegments() const;
+
+    QFile m_file;
+    QMutex m_mutex;
+    qint64 m_max_size;          // bytes, 0 if unlimited
+    qint64 m_max_age;           // seconds, 0 if unlimited
+    int m_keep;
+    qint64 m_size;
+    QDateTime m_opened;
+    QThreadPool m_compressor;
+};
+
+}
+
+#endif // ROTATINGLOGFILE_H
@@ -0,0 +1,114 @@
+#include "settingsregistry.h"
+#include "macros.h"
+#include "logcategories.h"
+
+#include <QSettings>
+
+using namespace yasem;
+
+static const int SETTINGS_RELEASE_INTERVAL = 60000; // ms
+
+SettingsRegistry* SettingsRegistry::m_instance = NULL;
+
+SettingsRegistry::SettingsRegistry(const QString &config_dir, QObject *parent) :
+    QObject(parent),
+    m_config_dir(config_dir)
+{
+    m_instance = this;
+
+    connect(&m_release_timer, &QTimer::timeout, this, &SettingsRegistry::onReleaseTimer);
+    m_release_timer.setInterval(SETTINGS_RELEASE_INTERVAL);
+    m_release_timer.start();
+}
+
+SettingsRegistry::~SettingsRegistry()
+{
+    sync();
+    if(m_instance == this)
+        m_instance = NULL;
+}
+
+SettingsRegistry* SettingsRegistry::instance()
+{
+    return m_instance;
+}
+
+/**
+ * @brief SettingsRegistry::settings
+ *
+ * Returns shared settings of a file in the config directory.
+ * Should be called from the main thread.
+ */
+QSettings* SettingsRegistry::settings(const QString &file_name, bool pinned)
+{
+    auto iterator = m_handles.find(file_name);
+    if(iterator == m_handles.end())
+    {
+        Handle handle;
+        handle.settings = new QSettings(filePath(file_name), QSettings::IniFormat, this);
+        handle.pinned = false;
+        iterator = m_handles.insert(file_name, handle);
+    }
+
+    iterator->pinned = iterator->pinned || pinned;
+    iterator->last_used.start();
+    return iterator->settings;
+}
+
+QString SettingsRegistry::filePath(const QString &file_name) const
+{
+    return QString(m_config_dir).append(file_name);
+}
+
+/**
+ * @brief SettingsRegistry::sync
+ *
+ * Writes pending changes of all files.
+ */
+void SettingsRegistry::sync()
+{
+    for(const Handle& handle: m_handles)
+        handle.settings->sync();
+}
+
+/**
+ * @brief SettingsRegistry::sync
+ *
+ * Writes pending changes of the file, so it can be read without QSettings.
+ * Objects of the same file share pending changes, so changes made through
+ * other QSettings objects are written as well.
+ */
+void SettingsRegistry::sync(const QString &file_name)
+{
+    auto iterator = m_handles.find(file_name);
+    if(iterator != m_handles.end())
+        iterator->settings->sync();
+}
+
+/**
+ * @brief SettingsRegistry::releaseIdle
+ *
+ * Syncs and deletes handles that are not pinned and haven't been used for idle_time ms.
+ * They are parsed again on the next request.
+ */
+void SettingsRegistry::releaseIdle(qint64 idle_time)
+{
+    for(auto iterator = m_handles.begin(); iterator != m_handles.end();)
+    {
+        if(iterator->pinned || iterator->last_used.elapsed() < idle_time)
+        {
+            ++iterator;
+            continue;
+        }
+
+        CONFIG_DEBUG() << "Releasing settings" << iterator.key();
+        iterator->settings->sync();
+        delete iterator->settings;
+        iterator = m_handles.erase(iterator);
+    }
+}
+
+void SettingsRegistry::onReleaseTimer()
+{
+    releaseIdle(SETTINGS_RELEASE_INTERVAL);
+}
@@ -0,0 +1,60 @@
+#ifndef SETTINGSREGISTRY_H
+#define SETTINGSREGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class QSettings;
+
+namespace yasem {
+
+/**
+ * @brief Keeps one QSettings object per config file.
+ *
+ * Every file is parsed once and its settings object is shared by the core code.
+ * Shared objects are never given to plugins except the application settings
+ * (@see CoreImpl::settings()), which are pinned and live until exit.
+ * Handles are used from the main thread only and groups must be closed after use.
+ * Other handles are synced and released after they haven't been used for a while
+ * or on releaseIdle().
+ */
+class SettingsRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SettingsRegistry(const QString &config_dir, QObject *parent = 0);
+    virtual ~SettingsRegistry();
+
+    static SettingsRegistry* instance();
+
+    QSettings* settings(const QString &file_name, bool pinned = false);
+    QString filePath(const QString &file_name) const;
+    void sync();
+    void sync(const QString &file_name);
+
+public slots:
+    void releaseIdle(qint64 idle_time = 0);
+
+protected slots:
+    void onReleaseTimer();
+
+protected:
+    struct Handle
+    {
+        QSettings* settings;
+        bool pinned;
+        QElapsedTimer last_used;
+    };
+
+    static SettingsRegistry* m_instance;
+
+    QString m_config_dir;
+    QHash<QString, Handle> m_handles;
+    QTimer m_release_timer;
+};
+
+}
+
+#endif // SETTINGSREGISTRY_H
@@ -1,49 +1,248 @@
-#ifdef Q_OS_LINUX
+#include "stacktrace.h"
+
+// Qt headers aren't included here, so Q_OS_LINUX can't be used
+#if defined(__linux__) && !defined(__ANDROID__)
 
 #include <execinfo.h>	// for backtrace
 #include <dlfcn.h>		// for dladdr
+#include <link.h>		// for dl_iterate_phdr
 #include <cxxabi.h>		// for __cxa_demangle
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstdint>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 
-// This function produces a stack backtrace with demangled function & method names.
-std::string Backtrace(int skip = 1)
+namespace {
+
+struct Module
 {
-    void *callstack[128];
-    const int nMaxFrames = sizeof(callstack) / sizeof(callstack[0]);
+    uintptr_t base;     // Load bias, offsets from it are accepted by addr2line
+    uintptr_t start;
+    uintptr_t end;
+    std::string name;
+};
+
+const size_t SYMBOL_CACHE_LIMIT = 8192;
+
+std::mutex s_mutex;
+std::vector<Module> s_modules;
+unsigned long long s_modules_adds = 0;
+unsigned long long s_modules_subs = 0;
+std::unordered_map<uintptr_t, std::string> s_symbols;
+std::unordered_map<uintptr_t, std::string> s_function_names;
+std::atomic<bool> s_raw_frames(false);
+
+int collectModule(struct dl_phdr_info* info, size_t size, void* data)
+{
+    std::vector<Module>* modules = static_cast<std::vector<Module>*>(data);
+
+    // The first callback tells whether the list has changed since the last update
+    if(modules->empty() && size >= offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs))
+    {
+        if(info->dlpi_adds == s_modules_adds && info->dlpi_subs == s_modules_subs && !s_modules.empty())
+            return 1;
+        s_modules_adds = info->dlpi_adds;
+        s_modules_subs = info->dlpi_subs;
+    }
+
+    Module module;
+    module.base = info->dlpi_addr;
+    module.start = UINTPTR_MAX;
+    module.end = 0;
+    module.name = info->dlpi_name != NULL && info->dlpi_name[0] != '\0' ? info->dlpi_name : "[main]";
+    for(int index = 0; index < info->dlpi_phnum; index++)
+    {
+        const ElfW(Phdr)& header = info->dlpi_phdr[index];
+        if(header.p_type != PT_LOAD) continue;
+
+        uintptr_t start = info->dlpi_addr + header.p_vaddr;
+        if(start < module.start) module.start = start;
+        if(start + header.p_memsz > module.end) module.end = start + header.p_memsz;
+    }
+    if(module.end > 0)
+        modules->push_back(module);
+    return 0;
+}
+
+// Must be called with the mutex locked
+void updateModules()
+{
+    std::vector<Module> modules;
+    dl_iterate_phdr(&collectModule, &modules);
+    if(!modules.empty())
+    {
+        s_modules.swap(modules);
+        // Modules could be unloaded and others loaded at the same addresses
+        s_symbols.clear();
+        s_function_names.clear();
+    }
+}
+
+const Module* findModule(uintptr_t address)
+{
+    for(const Module& module: s_modules)
+    {
+        if(address >= module.start && address < module.end)
+            return &module;
+    }
+    return NULL;
+}
+
+// Must be called with the mutex locked
+const std::string& symbolize(uintptr_t address)
+{
+    auto iterator = s_symbols.find(address);
+    if(iterator != s_symbols.end())
+        return iterator->second;
+
+    if(s_symbols.size() >= SYMBOL_CACHE_LIMIT)
+        s_symbols.clear();
+
     char buf[1024];
-    int nFrames = backtrace(callstack, nMaxFrames);
-    char **symbols = backtrace_symbols(callstack, nFrames);
+    Dl_info info;
+    if (dladdr((void*)address, &info) && info.dli_sname) {
+        char *demangled = NULL;
+        int status = -1;
+        if (info.dli_sname[0] == '_')
+            demangled = abi::__cxa_demangle(info.dli_sname, NULL, 0, &status);
+        snprintf(buf, sizeof(buf), "%s + %zd",
+                 status == 0 ? demangled : info.dli_sname,
+                 (char *)address - (char *)info.dli_saddr);
+        free(demangled);
+    } else {
+        const Module* module = findModule(address);
+        snprintf(buf, sizeof(buf), "%s+0x%zx",
+                 module != NULL ? module->name.c_str() : "??",
+                 module != NULL ? (size_t)(address - module->base) : (size_t)address);
+    }
+    return s_symbols.emplace(address, buf).first->second;
+}
+
+}
+
+std::string FrameName(void* address)
+{
+    std::lock_guard<std::mutex> locker(s_mutex);
+    updateModules();
 
+    auto iterator = s_function_names.find((uintptr_t)address);
+    if(iterator != s_function_names.end())
+        return iterator->second;
+
+    if(s_function_names.size() >= SYMBOL_CACHE_LIMIT)
+        s_function_names.clear();
+
+    std::string name;
+    Dl_info info;
+    if (dladdr(address, &info) && info.dli_sname) {
+        char *demangled = NULL;
+        int status = -1;
+        if (info.dli_sname[0] == '_')
+            demangled = abi::__cxa_demangle(info.dli_sname, NULL, 0, &status);
+        name = status == 0 ? demangled : info.dli_sname;
+        free(demangled);
+    } else {
+        char buf[1024];
+        const Module* module = findModule((uintptr_t)address);
+        snprintf(buf, sizeof(buf), "%s+0x%zx",
+                 module != NULL ? module->name.c_str() : "??",
+                 module != NULL ? (size_t)((uintptr_t)address - module->base) : (size_t)address);
+        name = buf;
+    }
+    return s_function_names.emplace((uintptr_t)address, name).first->second;
+}
+
+int CaptureStack(void** frames, int max_frames, int skip)
+{
+    std::vector<void*> callstack(max_frames + skip);
+    int count = backtrace(callstack.data(), (int)callstack.size());
+    count = count > skip ? count - skip : 0;
+    for(int index = 0; index < count; index++)
+        frames[index] = callstack[index + skip];
+    return count;
+}
+
+std::string FormatStack(void* const* frames, int count, bool raw)
+{
+    char buf[1200];
     std::ostringstream trace_buf;
-    for (int i = skip; i < nFrames; i++) {
-        printf("%s\n", symbols[i]);
-
-        Dl_info info;
-        if (dladdr(callstack[i], &info) && info.dli_sname) {
-            char *demangled = NULL;
-            int status = -1;
-            if (info.dli_sname[0] == '_')
-                demangled = abi::__cxa_demangle(info.dli_sname, NULL, 0, &status);
-            snprintf(buf, sizeof(buf), "%-3d %*p %s + %zd\n",
-                     i, int(2 + sizeof(void*) * 2), callstack[i],
-                     status == 0 ? demangled :
-                     info.dli_sname == 0 ? symbols[i] : info.dli_sname,
-                     (char *)callstack[i] - (char *)info.dli_saddr);
-            free(demangled);
+
+    std::lock_guard<std::mutex> locker(s_mutex);
+    updateModules();
+
+    for (int i = 0; i < count; i++) {
+        const uintptr_t address = (uintptr_t)frames[i];
+        if (raw) {
+            const Module* module = findModule(address);
+            snprintf(buf, sizeof(buf), "%-3d %*p %s+0x%zx\n",
+                     i, int(2 + sizeof(void*) * 2), frames[i],
+                     module != NULL ? module->name.c_str() : "??",
+                     module != NULL ? (size_t)(address - module->base) : (size_t)address);
         } else {
             snprintf(buf, sizeof(buf), "%-3d %*p %s\n",
-                     i, int(2 + sizeof(void*) * 2), callstack[i], symbols[i]);
+                     i, int(2 + sizeof(void*) * 2), frames[i], symbolize(address).c_str());
         }
         trace_buf << buf;
     }
-    free(symbols);
-    if (nFrames == nMaxFrames)
-        trace_buf << "[truncated]\n";
     return trace_buf.str();
 }
 
+void SetBacktraceRawFrames(bool raw)
+{
+    s_raw_frames = raw;
+}
+
+// This function produces a stack backtrace with demangled function & method names.
+std::string Backtrace(int skip)
+{
+    void *callstack[128];
+    const int nMaxFrames = sizeof(callstack) / sizeof(callstack[0]);
+    // Skip this function too
+    int nFrames = CaptureStack(callstack, nMaxFrames, skip + 1);
+
+    std::string trace = FormatStack(callstack, nFrames, s_raw_frames);
+    if (nFrames == nMaxFrames)
+        trace += "[truncated]\n";
+    return trace;
+}
+
+#else
+
+// Stack capture isn't supported, callers get empty traces
+
+int CaptureStack(void** frames, int max_frames, int skip)
+{
+    (void)frames; (void)max_frames; (void)skip;
+    return 0;
+}
+
+std::string FormatStack(void* const* frames, int count, bool raw)
+{
+    (void)frames; (void)count; (void)raw;
+    return std::string();
+}
+
+std::string FrameName(void* address)
+{
+    (void)address;
+    return std::string();
+}
+
+void SetBacktraceRawFrames(bool raw)
+{
+    (void)raw;
+}
+
+std::string Backtrace(int skip)
+{
+    (void)skip;
+    return std::string();
+}
+
 #endif
@@ -0,0 +1,26 @@
+#ifndef STACKTRACE_H
+#define STACKTRACE_H
+
+#include <string>
+
+/*
+ * Stack capture is cheap: only raw return addresses are recorded.
+ * Symbols are resolved later and cached, so repeated traces of the same
+ * code path don't demangle the same frames again.
+ */
+
+// Stores up to max_frames return addresses of the calling thread. Returns number of frames.
+int CaptureStack(void** frames, int max_frames, int skip = 1);
+
+// Formats captured frames. Raw frames are printed as module+offset for offline symbolization.
+std::string FormatStack(void* const* frames, int count, bool raw);
+
+// Returns demangled function name of the frame without offset, or module+offset if it's unknown
+std::string FrameName(void* address);
+
+// Makes Backtrace() print raw frames instead of symbols
+void SetBacktraceRawFrames(bool raw);
+
+std::string Backtrace(int skip = 1);
+
+#endif // STACKTRACE_H
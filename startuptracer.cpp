@@ -0,0 +1,189 @@
+#include "startuptracer.h"
+#include "macros.h"
+
+#include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QThread>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QCoreApplication>
+
+#include <algorithm>
+
+using namespace yasem;
+
+StartupTracer::StartupTracer():
+    m_enabled(false)
+{
+
+}
+
+StartupTracer* StartupTracer::instance()
+{
+    static StartupTracer tracer;
+    return &tracer;
+}
+
+void StartupTracer::init(const QStringList &arguments)
+{
+    for(const QString& arg: arguments)
+    {
+        if(arg.startsWith("--startup-trace="))
+        {
+            m_file_name = arg.mid(QString("--startup-trace=").length());
+            m_enabled = !m_file_name.isEmpty();
+            m_timer.start();
+            break;
+        }
+    }
+}
+
+bool StartupTracer::isEnabled() const
+{
+    return m_enabled;
+}
+
+/**
+ * @brief StartupTracer::now
+ *
+ * Monotonic time in microseconds since tracing has been started.
+ */
+qint64 StartupTracer::now() const
+{
+    return m_timer.nsecsElapsed() / 1000;
+}
+
+void StartupTracer::addEvent(const QString &name, qint64 start_us, qint64 end_us, const QString &plugin)
+{
+    if(!m_enabled) return;
+
+    Event event;
+    event.name = name;
+    event.plugin = plugin;
+    event.start = start_us;
+    event.duration = end_us - start_us;
+    event.thread = (quint64)QThread::currentThreadId();
+
+    QMutexLocker locker(&m_mutex);
+    m_events.append(event);
+}
+
+void StartupTracer::printSummary()
+{
+    if(!m_enabled) return;
+
+    static const QStringList columns = QStringList() << TRACE_PLUGIN_LOAD << TRACE_PLUGIN_ROLES
+                                                     << TRACE_PLUGIN_DEPENDENCIES << TRACE_PLUGIN_INIT
+                                                     << TRACE_PLUGIN_WAIT;
+
+    QHash<QString, QHash<QString, qint64>> timings;
+    {
+        QMutexLocker locker(&m_mutex);
+        for(const Event& event: m_events)
+        {
+            if(!event.plugin.isEmpty())
+                timings[event.plugin][event.name] += event.duration;
+        }
+    }
+
+    // Waiting for dependencies isn't plugin's own time, so it's not counted in total
+    QList<QPair<qint64, QString>> plugins;
+    for(auto iterator = timings.constBegin(); iterator != timings.constEnd(); iterator++)
+    {
+        qint64 total = 0;
+        for(const QString& column: columns)
+        {
+            if(column != TRACE_PLUGIN_WAIT)
+                total += iterator.value().value(column);
+        }
+        plugins.append(qMakePair(total, iterator.key()));
+    }
+    std::sort(plugins.begin(), plugins.end(), [](const QPair<qint64, QString>& a, const QPair<qint64, QString>& b) {
+        return a.first > b.first;
+    });
+
+    LOG() << "Startup timings, ms";
+    LOG() << qPrintable(QString(104, '-'));
+    QString header = QString("|%1|%2|").arg(QString("PLUGIN").leftJustified(30)).arg(QString("TOTAL").leftJustified(10));
+    for(const QString& column: columns)
+        header.append(QString("%1|").arg(column.toUpper().left(10).leftJustified(10)));
+    LOG() << qPrintable(header);
+    LOG() << qPrintable(QString(104, '-'));
+
+    for(const QPair<qint64, QString>& plugin: plugins)
+    {
+        QString line = QString("|%1|%2|").arg(plugin.second.leftJustified(30))
+                                         .arg(QString::number(plugin.first / 1000.0, 'f', 2).leftJustified(10));
+        for(const QString& column: columns)
+            line.append(QString("%1|").arg(QString::number(timings[plugin.second].value(column) / 1000.0, 'f', 2).leftJustified(10)));
+        LOG() << qPrintable(line);
+    }
+    LOG() << qPrintable(QString(104, '-'));
+}
+
+/**
+ * @brief StartupTracer::finish
+ *
+ * Writes all recorded events to the trace file and stops tracing.
+ */
+void StartupTracer::finish()
+{
+    if(!m_enabled) return;
+    m_enabled = false;
+
+    QJsonArray events;
+    QMutexLocker locker(&m_mutex);
+    for(const Event& event: m_events)
+    {
+        QJsonObject item;
+        item.insert("name", event.name);
+        item.insert("cat", event.plugin.isEmpty() ? "core" : "plugin");
+        item.insert("ph", "X");
+        item.insert("ts", (double)event.start);
+        item.insert("dur", (double)event.duration);
+        item.insert("pid", (double)QCoreApplication::applicationPid());
+        item.insert("tid", (double)event.thread);
+        if(!event.plugin.isEmpty())
+        {
+            QJsonObject args;
+            args.insert("plugin", event.plugin);
+            item.insert("args", args);
+        }
+        events.append(item);
+    }
+    m_events.clear();
+
+    QJsonObject root;
+    root.insert("traceEvents", events);
+    root.insert("displayTimeUnit", QString("ms"));
+
+    QFile file(m_file_name);
+    if(!file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        WARN() << "Cannot write startup trace to" << m_file_name;
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    LOG() << "Startup trace has been written to" << m_file_name;
+}
+
+StartupTraceScope::StartupTraceScope(const char *name, const QString &plugin):
+    m_name(name),
+    m_start(-1)
+{
+    StartupTracer* tracer = StartupTracer::instance();
+    if(tracer->isEnabled())
+    {
+        m_plugin = plugin;
+        m_start = tracer->now();
+    }
+}
+
+StartupTraceScope::~StartupTraceScope()
+{
+    if(m_start < 0) return;
+    StartupTracer* tracer = StartupTracer::instance();
+    tracer->addEvent(m_name, m_start, tracer->now(), m_plugin);
+}
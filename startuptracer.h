@@ -0,0 +1,74 @@
+#ifndef STARTUPTRACER_H
+#define STARTUPTRACER_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QMutex>
+#include <QElapsedTimer>
+
+namespace yasem {
+
+static const char* const TRACE_PLUGIN_LOAD            = "load";
+static const char* const TRACE_PLUGIN_ROLES           = "register_roles";
+static const char* const TRACE_PLUGIN_DEPENDENCIES    = "register_dependencies";
+static const char* const TRACE_PLUGIN_WAIT            = "wait_for_dependencies";
+static const char* const TRACE_PLUGIN_INIT            = "initialize";
+
+/**
+ * @brief Records a timeline of application startup.
+ *
+ * Enabled with --startup-trace=<file>. Events are written as Chrome trace JSON
+ * (chrome://tracing, ui.perfetto.dev) by finish(). Per-plugin events are also
+ * summarized in a table by printSummary().
+ */
+class StartupTracer
+{
+public:
+    static StartupTracer* instance();
+
+    void init(const QStringList &arguments);
+    bool isEnabled() const;
+    qint64 now() const;
+
+    void addEvent(const QString &name, qint64 start_us, qint64 end_us, const QString &plugin = QString());
+    void printSummary();
+    void finish();
+
+protected:
+    StartupTracer();
+
+    struct Event
+    {
+        QString name;
+        QString plugin;
+        qint64 start;
+        qint64 duration;
+        quint64 thread;
+    };
+
+    bool m_enabled;
+    QString m_file_name;
+    QElapsedTimer m_timer;
+    QMutex m_mutex;
+    QList<Event> m_events;
+};
+
+/**
+ * @brief Adds an event that lasts until the scope ends.
+ */
+class StartupTraceScope
+{
+public:
+    StartupTraceScope(const char* name, const QString &plugin = QString());
+    ~StartupTraceScope();
+
+protected:
+    const char* m_name;
+    QString m_plugin;
+    qint64 m_start;
+};
+
+}
+
+#endif // STARTUPTRACER_H
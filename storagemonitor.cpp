@@ -0,0 +1,188 @@
+#include "storagemonitor.h"
+#include "macros.h"
+#include "logcategories.h"
+
+#include <QSocketNotifier>
+#include <QFile>
+
+#ifdef Q_OS_UNIX
+#include <sys/statvfs.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif //Q_OS_UNIX
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#endif //Q_OS_LINUX
+
+using namespace yasem;
+
+static const int STORAGE_NOTIFY_DELAY = 250; // ms
+
+StorageMonitor::StorageMonitor(QObject *parent) :
+    QObject(parent),
+    m_mounts_fd(-1),
+    m_uevent_fd(-1),
+    m_mounts_notifier(NULL),
+    m_uevent_notifier(NULL)
+{
+    m_notify_timer.setSingleShot(true);
+    m_notify_timer.setInterval(STORAGE_NOTIFY_DELAY);
+    connect(&m_notify_timer, &QTimer::timeout, this, &StorageMonitor::storagesChanged);
+}
+
+StorageMonitor::~StorageMonitor()
+{
+    stop();
+}
+
+bool StorageMonitor::start()
+{
+    if(isActive()) return true;
+
+#ifdef Q_OS_LINUX
+    if(!openMounts())
+    {
+        WARN() << "Cannot watch mount table changes";
+        return false;
+    }
+
+    // Mounts are still tracked without hotplug events
+    if(!openUevents())
+        WARN() << "Cannot receive block device events";
+
+    CORE_DEBUG() << "Storage monitor started";
+    return true;
+#else
+    return false;
+#endif //Q_OS_LINUX
+}
+
+void StorageMonitor::stop()
+{
+    m_notify_timer.stop();
+
+    delete m_mounts_notifier;
+    m_mounts_notifier = NULL;
+    delete m_uevent_notifier;
+    m_uevent_notifier = NULL;
+
+#ifdef Q_OS_UNIX
+    if(m_mounts_fd >= 0)
+        ::close(m_mounts_fd);
+    if(m_uevent_fd >= 0)
+        ::close(m_uevent_fd);
+#endif //Q_OS_UNIX
+    m_mounts_fd = -1;
+    m_uevent_fd = -1;
+}
+
+bool StorageMonitor::isActive() const
+{
+    return m_mounts_notifier != NULL;
+}
+
+/**
+ * @brief StorageMonitor::readUsage
+ *
+ * Reads total and available space of a mounted file system.
+ * May block on a stale network mount, so don't call it from the main thread.
+ */
+bool StorageMonitor::readUsage(const QString &mount_point, quint64 &size, quint64 &available)
+{
+#ifdef Q_OS_UNIX
+    struct statvfs info;
+    if(::statvfs(QFile::encodeName(mount_point).constData(), &info) != 0)
+        return false;
+
+    size = (quint64)info.f_blocks * info.f_frsize;
+    available = (quint64)info.f_bavail * info.f_frsize;
+    return true;
+#else
+    Q_UNUSED(mount_point)
+    Q_UNUSED(size)
+    Q_UNUSED(available)
+    return false;
+#endif //Q_OS_UNIX
+}
+
+QList<StorageUsage> StorageMonitor::readUsageList(const QStringList &mount_points)
+{
+    QList<StorageUsage> result;
+    for(const QString& mount_point: mount_points)
+    {
+        StorageUsage usage;
+        usage.mount_point = mount_point;
+        if(readUsage(mount_point, usage.size, usage.available))
+            result.append(usage);
+    }
+    return result;
+}
+
+void StorageMonitor::onMountsChanged()
+{
+    CORE_DEBUG() << "Mount table changed";
+    m_notify_timer.start();
+}
+
+void StorageMonitor::onUeventReceived()
+{
+#ifdef Q_OS_LINUX
+    // Message format: "action@devpath\0KEY=VALUE\0KEY=VALUE\0..."
+    char buffer[4096];
+    ssize_t length = ::recv(m_uevent_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if(length <= 0) return;
+
+    const QByteArray message = QByteArray::fromRawData(buffer, (int)length);
+    const QList<QByteArray> fields = message.split('\0');
+    if(!fields.contains("SUBSYSTEM=block"))
+        return;
+
+    CORE_DEBUG() << "Block device event" << fields.first();
+    m_notify_timer.start();
+#endif //Q_OS_LINUX
+}
+
+bool StorageMonitor::openMounts()
+{
+#ifdef Q_OS_LINUX
+    // The kernel marks the file with POLLPRI (exceptional condition) when mount table changes
+    m_mounts_fd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if(m_mounts_fd < 0)
+        return false;
+
+    m_mounts_notifier = new QSocketNotifier(m_mounts_fd, QSocketNotifier::Exception, this);
+    connect(m_mounts_notifier, &QSocketNotifier::activated, this, &StorageMonitor::onMountsChanged);
+    return true;
+#else
+    return false;
+#endif //Q_OS_LINUX
+}
+
+bool StorageMonitor::openUevents()
+{
+#ifdef Q_OS_LINUX
+    m_uevent_fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if(m_uevent_fd < 0)
+        return false;
+
+    struct sockaddr_nl address = {};
+    address.nl_family = AF_NETLINK;
+    address.nl_pid = 0;
+    address.nl_groups = 1; // Kernel events
+
+    if(::bind(m_uevent_fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        ::close(m_uevent_fd);
+        m_uevent_fd = -1;
+        return false;
+    }
+
+    m_uevent_notifier = new QSocketNotifier(m_uevent_fd, QSocketNotifier::Read, this);
+    connect(m_uevent_notifier, &QSocketNotifier::activated, this, &StorageMonitor::onUeventReceived);
+    return true;
+#else
+    return false;
+#endif //Q_OS_LINUX
+}
@@ -0,0 +1,64 @@
+#ifndef STORAGEMONITOR_H
+#define STORAGEMONITOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QStringList>
+#include <QList>
+
+class QSocketNotifier;
+
+namespace yasem {
+
+struct StorageUsage
+{
+    QString mount_point;
+    quint64 size;
+    quint64 available;
+};
+
+/**
+ * @brief Watches for mount table changes and block device hotplug events.
+ *
+ * Mount table changes are reported by the kernel as POLLPRI on /proc/self/mountinfo,
+ * block device events come from the kernel uevent netlink socket. Events come in bursts
+ * (device added, partitions added, automount), so storagesChanged() is emitted once
+ * after a short delay.
+ *
+ * Only available on Linux. On other platforms start() returns false.
+ */
+class StorageMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StorageMonitor(QObject *parent = 0);
+    virtual ~StorageMonitor();
+
+    bool start();
+    void stop();
+    bool isActive() const;
+
+    static bool readUsage(const QString &mount_point, quint64 &size, quint64 &available);
+    static QList<StorageUsage> readUsageList(const QStringList &mount_points);
+
+signals:
+    void storagesChanged();
+
+protected slots:
+    void onMountsChanged();
+    void onUeventReceived();
+
+protected:
+    bool openMounts();
+    bool openUevents();
+
+    int m_mounts_fd;
+    int m_uevent_fd;
+    QSocketNotifier* m_mounts_notifier;
+    QSocketNotifier* m_uevent_notifier;
+    QTimer m_notify_timer;
+};
+
+}
+
+#endif // STORAGEMONITOR_H
@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Checks BlockDeviceReader against a fake sysfs tree
+#
+#-------------------------------------------------
+
+TARGET = tst_blockdevicereader
+TEMPLATE = app
+
+QT += core testlib
+QT -= gui
+
+CONFIG += console c++11 testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += tst_blockdevicereader.cpp \
+    ../../blockdevicereader.cpp
+
+HEADERS += ../../blockdevicereader.h
@@ -0,0 +1,136 @@
+#include "blockdevicereader.h"
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+using namespace yasem;
+
+class BlockDeviceReaderTest: public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void readsDisksAndPartitions();
+    void readsRemovableDevice();
+    void readsMounts();
+    void unescapesMountPath();
+
+protected:
+    void writeFile(const QString &path, const QByteArray &data);
+
+    QTemporaryDir m_root;
+};
+
+void BlockDeviceReaderTest::writeFile(const QString &path, const QByteArray &data)
+{
+    const QString file_name = m_root.path() + "/" + path;
+    QVERIFY(QDir().mkpath(QFileInfo(file_name).absolutePath()));
+
+    QFile file(file_name);
+    QVERIFY(file.open(QFile::WriteOnly));
+    file.write(data);
+}
+
+/**
+ * Fixed disk with a partition, removable disk with a partition mounted to a path
+ * with a space and a loop device that must be skipped.
+ */
+void BlockDeviceReaderTest::initTestCase()
+{
+    QVERIFY(m_root.isValid());
+
+    writeFile("sys/block/sda/dev", "8:0\n");
+    writeFile("sys/block/sda/size", "2048\n");
+    writeFile("sys/block/sda/removable", "0\n");
+    writeFile("sys/block/sda/device/model", "Fixed Disk  \n");
+    writeFile("sys/block/sda/device/vendor", "ATA\n");
+    writeFile("sys/block/sda/sda1/partition", "1\n");
+    writeFile("sys/block/sda/sda1/dev", "8:1\n");
+    writeFile("sys/block/sda/sda1/size", "1024\n");
+
+    writeFile("sys/block/sdb/dev", "8:16\n");
+    writeFile("sys/block/sdb/size", "4096\n");
+    writeFile("sys/block/sdb/removable", "1\n");
+    writeFile("sys/block/sdb/device/model", "Flash\n");
+    writeFile("sys/block/sdb/sdb1/partition", "1\n");
+    writeFile("sys/block/sdb/sdb1/dev", "8:17\n");
+    writeFile("sys/block/sdb/sdb1/size", "4000\n");
+
+    writeFile("sys/block/loop0/dev", "7:0\n");
+    writeFile("sys/block/loop0/size", "100\n");
+
+    writeFile("proc/self/mountinfo",
+              "22 1 0:20 / /proc rw,nosuid - proc proc rw\n"
+              "36 25 8:1 / / rw,relatime shared:1 - ext4 /dev/root rw\n"
+              "40 36 8:17 / /media/My\\040Disk rw,nosuid shared:5 master:2 - vfat /dev/sdb1 rw\n");
+}
+
+void BlockDeviceReaderTest::readsDisksAndPartitions()
+{
+    const QList<BlockDevice> disks = BlockDeviceReader(m_root.path()).readDisks();
+    QCOMPARE(disks.size(), 2);
+
+    const BlockDevice& disk = disks.at(0);
+    QCOMPARE(disk.name, QString("sda"));
+    QCOMPARE(disk.device, QString("8:0"));
+    QCOMPARE(disk.device_file, QString("/dev/sda"));
+    QCOMPARE(disk.size, quint64(2048 * 512));
+    QCOMPARE(disk.model, QString("Fixed Disk"));
+    QCOMPARE(disk.vendor, QString("ATA"));
+    QVERIFY(!disk.removable);
+    QVERIFY(disk.mount_point.isEmpty());
+
+    QCOMPARE(disk.partitions.size(), 1);
+    const BlockDevice& partition = disk.partitions.at(0);
+    QCOMPARE(partition.name, QString("sda1"));
+    QCOMPARE(partition.device, QString("8:1"));
+    QCOMPARE(partition.size, quint64(1024 * 512));
+    QCOMPARE(partition.model, QString("Fixed Disk"));
+    QCOMPARE(partition.mount_point, QString("/"));
+    QCOMPARE(partition.fs_type, QString("ext4"));
+}
+
+void BlockDeviceReaderTest::readsRemovableDevice()
+{
+    const QList<BlockDevice> disks = BlockDeviceReader(m_root.path()).readDisks();
+    QCOMPARE(disks.size(), 2);
+
+    const BlockDevice& disk = disks.at(1);
+    QCOMPARE(disk.name, QString("sdb"));
+    QVERIFY(disk.removable);
+    QVERIFY(!disk.cdrom);
+
+    QCOMPARE(disk.partitions.size(), 1);
+    const BlockDevice& partition = disk.partitions.at(0);
+    QVERIFY(partition.removable);
+    QCOMPARE(partition.mount_point, QString("/media/My Disk"));
+    QCOMPARE(partition.fs_type, QString("vfat"));
+}
+
+void BlockDeviceReaderTest::readsMounts()
+{
+    const QList<MountInfo> mounts = BlockDeviceReader(m_root.path()).readMounts();
+    QCOMPARE(mounts.size(), 3);
+
+    QCOMPARE(mounts.at(1).device, QString("8:1"));
+    QCOMPARE(mounts.at(1).mount_point, QString("/"));
+    QCOMPARE(mounts.at(1).source, QString("/dev/root"));
+
+    // Optional fields before the separator don't shift the fields after it
+    QCOMPARE(mounts.at(2).device, QString("8:17"));
+    QCOMPARE(mounts.at(2).mount_point, QString("/media/My Disk"));
+    QCOMPARE(mounts.at(2).fs_type, QString("vfat"));
+    QCOMPARE(mounts.at(2).source, QString("/dev/sdb1"));
+}
+
+void BlockDeviceReaderTest::unescapesMountPath()
+{
+    QCOMPARE(BlockDeviceReader::unescapeMountPath("/mnt/plain"), QString("/mnt/plain"));
+    QCOMPARE(BlockDeviceReader::unescapeMountPath("/mnt/a\\040b"), QString("/mnt/a b"));
+    QCOMPARE(BlockDeviceReader::unescapeMountPath("/mnt/tab\\011"), QString("/mnt/tab\t"));
+    QCOMPARE(BlockDeviceReader::unescapeMountPath("/mnt/back\\134slash"), QString("/mnt/back\\slash"));
+}
+
+QTEST_GUILESS_MAIN(BlockDeviceReaderTest)
+
+#include "tst_blockdevicereader.moc"
@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Compares IniFile with QSettings on real config files
+#
+#-------------------------------------------------
+
+TARGET = inibench
+TEMPLATE = app
+
+QT += core
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../inifile.cpp
+
+HEADERS += ../../inifile.h
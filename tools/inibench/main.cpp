@@ -0,0 +1,158 @@
+#include "inifile.h"
+
+#include <QCoreApplication>
+#include <QSettings>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QHash>
+
+#include <cstdio>
+
+using namespace yasem;
+
+static void printUsage()
+{
+    fprintf(stderr, "Usage: inibench [--iterations=N] <INI file or directory>...\n"
+                    "Reads every key of the files with QSettings and IniFile, compares the values and prints timings.\n"
+                    "QSettings is timed on the first read of a file, later reads come from its cache.\n"
+                    "Profiles and keymaps are in the config directory, e.g. ~/.config/yasem.\n");
+}
+
+static QStringList findFiles(const QStringList &paths)
+{
+    QStringList result;
+    for(const QString& path: paths)
+    {
+        if(QFileInfo(path).isDir())
+        {
+            QDirIterator iterator(path, QStringList() << "*.ini", QDir::Files, QDirIterator::Subdirectories);
+            while(iterator.hasNext())
+                result.append(iterator.next());
+        }
+        else
+            result.append(path);
+    }
+    return result;
+}
+
+static qint64 readWithQSettings(const QString &file_name)
+{
+    qint64 count = 0;
+    QSettings settings(file_name, QSettings::IniFormat);
+    for(const QString& key: settings.allKeys())
+        count += settings.value(key).toString().size();
+    return count;
+}
+
+static qint64 readWithIniFile(const QString &file_name)
+{
+    qint64 count = 0;
+    IniFile ini(file_name);
+    ini.open();
+    for(const QString& key: ini.keys())
+        count += ini.value(key).toString().size();
+    return count;
+}
+
+static int compareFile(const QString &file_name)
+{
+    QSettings settings(file_name, QSettings::IniFormat);
+    IniFile ini(file_name);
+    ini.open();
+
+    int errors = 0;
+    QStringList settings_keys = settings.allKeys();
+    QStringList ini_keys = ini.keys();
+    settings_keys.sort();
+    ini_keys.sort();
+    if(settings_keys != ini_keys)
+    {
+        fprintf(stderr, "%s: keys differ (%d in QSettings, %d in IniFile)\n",
+                qPrintable(file_name), settings_keys.size(), ini_keys.size());
+        errors++;
+    }
+
+    for(const QString& key: settings_keys)
+    {
+        if(settings.value(key) != ini.value(key))
+        {
+            fprintf(stderr, "%s: value of %s differs\n", qPrintable(file_name), qPrintable(key));
+            errors++;
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int iterations = 100;
+    QStringList arguments = app.arguments().mid(1);
+    for(int index = arguments.size() - 1; index >= 0; index--)
+    {
+        if(arguments.at(index).startsWith("--iterations="))
+        {
+            iterations = qMax(1, arguments.takeAt(index).mid(13).toInt());
+        }
+    }
+
+    const QStringList files = findFiles(arguments);
+    if(files.isEmpty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    // QSettings keeps parsed files in a process-wide cache and never parses a file again,
+    // while IniFile parses the file on every open. So the first QSettings read of every file
+    // is compared with IniFile, cached QSettings reads are shown for reference only.
+    QHash<QString, qint64> first_read;
+    for(const QString& file_name: files)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        readWithQSettings(file_name);
+        first_read.insert(file_name, timer.nsecsElapsed() / 1000);
+    }
+
+    int errors = 0;
+    for(const QString& file_name: files)
+        errors += compareFile(file_name);
+
+    printf("%-60s %12s %12s %8s %12s\n", "File", "QSettings,us", "IniFile,us", "Ratio", "Cached,us");
+    qint64 total_settings = 0;
+    qint64 total_ini = 0;
+    for(const QString& file_name: files)
+    {
+        QElapsedTimer timer;
+        qint64 checksum = 0;
+
+        timer.start();
+        for(int index = 0; index < iterations; index++)
+            checksum += readWithQSettings(file_name);
+        const qint64 cached_time = timer.nsecsElapsed() / iterations / 1000;
+
+        timer.restart();
+        for(int index = 0; index < iterations; index++)
+            checksum -= readWithIniFile(file_name);
+        const qint64 ini_time = timer.nsecsElapsed() / iterations / 1000;
+
+        if(checksum != 0)
+            errors++;
+
+        const qint64 settings_time = first_read.value(file_name);
+        total_settings += settings_time;
+        total_ini += ini_time;
+        printf("%-60s %12lld %12lld %8.2f %12lld\n", qPrintable(file_name), settings_time, ini_time,
+               ini_time > 0 ? double(settings_time) / ini_time : 0.0, cached_time);
+    }
+
+    printf("%-60s %12lld %12lld %8.2f\n", "Total", total_settings, total_ini,
+           total_ini > 0 ? double(total_settings) / total_ini : 0.0);
+
+    if(errors > 0)
+        fprintf(stderr, "%d differences found\n", errors);
+    return errors > 0 ? 2 : 0;
+}
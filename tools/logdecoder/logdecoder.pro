@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Converts binary log of YASEM (--log-binary) into text log
+#
+#-------------------------------------------------
+
+TARGET = logdecoder
+TEMPLATE = app
+
+QT += core
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp
+
+HEADERS += ../../logformat.h
@@ -0,0 +1,79 @@
+#include "logformat.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QDateTime>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace yasem;
+
+static void printUsage()
+{
+    fprintf(stderr, "Usage: logdecoder [--category] [--thread] <binary log file>\n");
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList arguments = app.arguments().mid(1);
+    const bool print_category = arguments.removeAll("--category") > 0;
+    const bool print_thread = arguments.removeAll("--thread") > 0;
+
+    if(arguments.size() != 1)
+    {
+        printUsage();
+        return 1;
+    }
+
+    QFile file(arguments.first());
+    if(!file.open(QFile::ReadOnly))
+    {
+        fprintf(stderr, "Cannot open %s\n", qPrintable(file.fileName()));
+        return 1;
+    }
+
+    LogBinaryHeader header;
+    if(file.read((char*)&header, sizeof(header)) != sizeof(header)
+            || header.magic != LOG_BINARY_MAGIC
+            || header.version != LOG_BINARY_VERSION
+            || header.record_size != sizeof(LogBinaryRecord))
+    {
+        fprintf(stderr, "%s is not a binary log file or has unsupported version\n", qPrintable(file.fileName()));
+        return 1;
+    }
+
+    QVector<LogBinaryRecord> records;
+    records.reserve(header.capacity);
+
+    LogBinaryRecord record;
+    while(file.read((char*)&record, sizeof(record)) == sizeof(record))
+    {
+        if(record.sequence != 0)
+            records.append(record);
+    }
+
+    std::sort(records.begin(), records.end(), [](const LogBinaryRecord& left, const LogBinaryRecord& right) {
+        return left.sequence < right.sequence;
+    });
+
+    for(const LogBinaryRecord& item: records)
+    {
+        QByteArray line(logTypeLabel(item.type));
+        line.append('[').append(QDateTime::fromMSecsSinceEpoch(item.timestamp).toString("hh:mm:ss:zzz").toLatin1()).append("] ");
+
+        if(print_category)
+            line.append('<').append(item.category, (int)qstrnlen(item.category, LOG_BINARY_CATEGORY_SIZE)).append("> ");
+        if(print_thread)
+            line.append("0x").append(QByteArray::number(item.thread_id, 16)).append(' ');
+
+        line.append(item.message, qMin<int>(item.length, LOG_BINARY_MESSAGE_SIZE)).append('\n');
+        fwrite(line.constData(), 1, line.size(), stdout);
+    }
+
+    return 0;
+}
@@ -16,7 +16,7 @@ ICON = resources/logo.ico
 
 include($${top_srcdir}/common.pri)
 
-QT += core widgets network
+QT += core widgets network concurrent
 equals(QT_MAJOR_VERSION, 5): {
     QT -= gui
 }
@@ -43,6 +43,23 @@ SOURCES += main.cpp \
     profileconfigparserimpl.cpp \
     sambaimpl.cpp \
     mountpointinfo.cpp \
+    pluginmetadatacache.cpp \
+    plugindependencygraph.cpp \
+    plugininvocationproxy.cpp \
+    startuptracer.cpp \
+    blockdevicereader.cpp \
+    storagemonitor.cpp \
+    logringbuffer.cpp \
+    logwriterthread.cpp \
+    logcategories.cpp \
+    binarylogsink.cpp \
+    rotatinglogfile.cpp \
+    crashrecorder.cpp \
+    cpuprofiler.cpp \
+    settingsregistry.cpp \
+    configwritebehind.cpp \
+    inifile.cpp \
+    configsnapshot.cpp \
     networkstatisticsimpl.cpp \
     statisticsimpl.cpp \
     systemstatisticsimpl.cpp \
@@ -64,7 +81,29 @@ HEADERS += \
     statisticsimpl.h \
     systemstatisticsimpl.h \
     configimpl.h \
-    datasourcefactoryimpl.h
+    datasourcefactoryimpl.h \
+    pluginmetadata.h \
+    pluginmetadatacache.h \
+    plugindependencygraph.h \
+    plugininvocationproxy.h \
+    startuptracer.h \
+    blockdevicereader.h \
+    storagemonitor.h \
+    logringbuffer.h \
+    logwriterthread.h \
+    logcategories.h \
+    logformat.h \
+    binarylogsink.h \
+    rotatinglogfile.h \
+    crashrecorder.h \
+    stacktrace.h \
+    cpuprofiler.h \
+    settingsregistry.h \
+    configkey.h \
+    configkeys.h \
+    configwritebehind.h \
+    inifile.h \
+    configsnapshot.h
 
 unix:!mac{
   QMAKE_LFLAGS += -Wl,--rpath=\\\$\$ORIGIN/
@@ -73,6 +112,11 @@ unix:!mac{
   #QMAKE_RPATH +=
 }
 
+linux:!android {
+  # timer_create() for CPU profiler
+  LIBS += -lrt
+}
+
 OTHER_FILES += \
     LICENSE \
     README.md